@@ -0,0 +1,175 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include "Analyze.h"
+#include "Board.h"
+#include "Search.h"
+#include "SearchStats.h"
+#include "TranspositionTable.h"
+#include "Util.h"
+
+namespace {
+    struct Position {
+        std::string fen;
+        std::string id;
+    };
+
+    auto IsNumber(const std::string& str) -> bool {
+        return !str.empty() && std::all_of(str.begin(), str.end(), [](char c) { return c >= '0' && c <= '9'; });
+    }
+
+    // Accepts FEN lines and EPD lines, which have operations like bm and id instead of the move counters.
+    // Returns false for lines that ParseFENBoard would reject.
+    auto ParsePositionLine(const std::string& line, Position& position) -> bool {
+        std::istringstream is(line);
+        std::vector<std::string> fields;
+        for (std::string field; fields.size() < 6 && is >> field;) {
+            fields.push_back(field);
+        }
+        if (fields.size() < 4) return false;
+        if (Split(fields[0], '/').size() != 8) return false;
+        if (fields[1] != "w" && fields[1] != "b") return false;
+        if (fields[3] != "-" && fields[3].length() != 2) return false;
+
+        position.fen = fields[0] + " " + fields[1] + " " + fields[2] + " " + fields[3];
+        if (fields.size() >= 6 && IsNumber(fields[4]) && IsNumber(fields[5])) {
+            position.fen += " " + fields[4] + " " + fields[5];
+            return true;
+        }
+
+        auto id = line.find("id \"");
+        if (id != std::string::npos) {
+            auto end = line.find('"', id + 4);
+            position.id = line.substr(id + 4, end == std::string::npos ? std::string::npos : end - id - 4);
+        }
+        return true;
+    }
+
+    auto EscapeJson(const std::string& str) -> std::string {
+        std::string escaped;
+        for (auto c : str) {
+            if (c == '"' || c == '\\') escaped += '\\';
+            escaped += c;
+        }
+        return escaped;
+    }
+
+    // "cp 23" or "mate 3" as {"cp":23} or {"mate":3}
+    auto FormatJsonScore(int score) -> std::string {
+        auto formatted = FormatScore(score);
+        auto space = formatted.find(' ');
+        return "{\"" + formatted.substr(0, space) + "\":" + formatted.substr(space + 1) + "}";
+    }
+
+    auto AnalyzePosition(int index, const std::string& line, const SearchLimits& limits) -> std::string {
+        std::ostringstream os;
+        os << "{\"index\":" << index;
+
+        Position position;
+        if (!ParsePositionLine(line, position)) {
+            searchStats.Reset();
+            os << ",\"error\":\"invalid position\"}";
+            return os.str();
+        }
+        if (!position.id.empty()) os << ",\"id\":\"" << EscapeJson(position.id) << "\"";
+        os << ",\"fen\":\"" << position.fen << "\"";
+
+        ParseFENBoard(theBoard, position.fen);
+        ClearHistory();
+        auto startTime = std::chrono::steady_clock::now();
+        SearchBestMove(limits);
+        auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime).count();
+
+        auto& result = GetLastSearchResult();
+        if (result.bestMove == INVALID_MOVE) {
+            os << ",\"bestmove\":null";
+        }
+        else {
+            os << ",\"bestmove\":\"" << MoveToUCI(result.bestMove) << "\""
+                << ",\"score\":" << FormatJsonScore(result.score);
+        }
+        os << ",\"depth\":" << result.depth
+            << ",\"nodes\":" << searchStats.GetTotalNodes()
+            << ",\"time\":" << ms
+            << ",\"pv\":[";
+        for (size_t i = 0; i < result.pv.size() && result.bestMove != INVALID_MOVE; i++) {
+            os << (i > 0 ? "," : "") << "\"" << MoveToUCI(result.pv[i]) << "\"";
+        }
+        os << "]}";
+        return os.str();
+    }
+}
+
+auto Analyze(const AnalyzeOptions& options) -> bool {
+    std::ifstream is(options.inputFile);
+    if (!is) {
+        std::cerr << "Cannot open " << options.inputFile << "\n";
+        return false;
+    }
+    std::vector<std::string> lines;
+    for (std::string line; std::getline(is, line);) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (line.empty() || line[0] == '#') continue;
+        lines.push_back(line);
+    }
+
+    std::ofstream file;
+    if (!options.outputFile.empty()) {
+        file.open(options.outputFile);
+        if (!file) {
+            std::cerr << "Cannot write " << options.outputFile << "\n";
+            return false;
+        }
+    }
+    auto& output = options.outputFile.empty() ? std::cout : file;
+
+    SearchLimits limits;
+    limits.depth = options.depth;
+    limits.nodes = options.nodes;
+    limits.moveTime = options.moveTime;
+    if (!limits.HasLimits()) limits.depth = DEFAULT_ANALYZE_DEPTH;
+
+    // Every worker has its own table, board, killers and statistics, the shared table is not used
+    ResizeTranspositionTable(0);
+
+    auto threads = options.threads > 0 ? options.threads : std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    auto megabytes = std::max(1, options.hashMegabytes / threads);
+    auto startTime = std::chrono::steady_clock::now();
+
+    // Positions are handed out one at a time, so a worker stuck on a hard position does not hold up the rest
+    std::atomic<int> nextPosition = 0;
+    std::atomic<uint64_t> totalNodes = 0;
+    std::mutex outputMutex;
+    std::vector<std::thread> workers;
+    for (int i = 0; i < threads; i++) {
+        workers.emplace_back([&]() {
+            UseThreadTranspositionTable(megabytes);
+            while (true) {
+                auto index = nextPosition++;
+                if (index >= static_cast<int>(lines.size())) return;
+                // Cleared, so a result does not depend on which positions the worker analyzed before
+                ClearTranspositionTable();
+                auto json = AnalyzePosition(index, lines[index], limits);
+                totalNodes += searchStats.GetTotalNodes();
+
+                std::lock_guard lock(outputMutex);
+                output << json << std::endl;
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime).count();
+    std::cerr << "Analyzed " << lines.size() << " positions in " << ms << " ms, "
+        << totalNodes * 1000 / std::max<int64_t>(ms, 1) << " nodes/second\n";
+    return true;
+}
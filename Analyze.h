@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+constexpr int DEFAULT_ANALYZE_DEPTH = 6;
+constexpr int DEFAULT_ANALYZE_HASH = 256;
+
+struct AnalyzeOptions {
+    std::string inputFile;
+    // Empty writes to standard output
+    std::string outputFile;
+    // Zero uses all cores
+    int threads = 0;
+    int hashMegabytes = DEFAULT_ANALYZE_HASH;
+    // Without any of these the positions are searched to the default depth
+    int depth = 0;
+    uint64_t nodes = 0;
+    int moveTime = 0;
+};
+
+// Searches every position of an EPD or FEN file on a pool of threads. Results are written as one JSON
+// object per line in the order they finish, with the index of the position in the file.
+auto Analyze(const AnalyzeOptions& options) -> bool;
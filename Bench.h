@@ -0,0 +1,15 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+constexpr int DEFAULT_BENCH_DEPTH = 6;
+constexpr int DEFAULT_BENCH_THREADS = 1;
+constexpr int DEFAULT_BENCH_HASH = 16;
+
+// Searches a fixed set of positions to a fixed depth and prints the total nodes and nodes per second.
+// The node count is deterministic for any number of threads and works as a signature of the search. Every thread
+// has a table of the given size.
+void Bench(int depth = DEFAULT_BENCH_DEPTH, int threads = DEFAULT_BENCH_THREADS, int hashMegabytes = DEFAULT_BENCH_HASH);
+
+auto GetBenchPositions() -> std::vector<std::string>;
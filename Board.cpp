@@ -1,469 +1,493 @@
-#include <sstream>
-#include <vector>
-
-#include "Board.h"
-#include "Util.h"
-#include "Zobrist.h"
-
-enum class SpecialMove {
-    NORMAL_MOVE,
-    EN_PASSANT,
-    PROMOTION
-};
-
-struct HistoricMove {
-    Square from;
-    Square to;
-    Piece capturedPiece;
-    SpecialMove specialMove;
-    int8_t previousEnPassentFile;
-    int8_t previousCastlingRights;
-};
-
-std::vector<HistoricMove> history;
-
-Board theBoard;
-
-void DoMove(const Move& move) {
-    auto specialMove = SpecialMove::NORMAL_MOVE;
-
-    // Apply castling move
-    Piece king;
-    Piece rook;
-    Piece pawn;
-    Piece queen;
-    int8_t kingRank;
-    int8_t pawnRank;
-    int8_t pawn2MoveRank;
-    auto previousEnPassentFile = theBoard.GetEnPassentFile();
-    auto previousCastlingRights = theBoard.GetCastlingRights();
-
-
-    if (theBoard.GetTurn() == Color::WHITE) {
-        king = Piece::WHITE_KING;
-        rook = Piece::WHITE_ROOK;
-        pawn = Piece::WHITE_PAWN;
-        queen = Piece::WHITE_QUEEN;
-        kingRank = 0;
-        pawnRank = 1;
-        pawn2MoveRank = 3;
-    }
-    else {
-        king = Piece::BLACK_KING;
-        rook = Piece::BLACK_ROOK;
-        pawn = Piece::BLACK_PAWN;
-        queen = Piece::BLACK_QUEEN;
-        kingRank = 7;
-        pawnRank = 6;
-        pawn2MoveRank = 4;
-    }
-
-    if (theBoard(move.from) == king) {
-        theBoard.SetCastlingRights(CastlingSide::KING, false);
-        theBoard.SetCastlingRights(CastlingSide::QUEEN, false);
-
-        if (move.from == Square{ kingRank, 4 }) {
-            if (move.to == Square{ kingRank, 2 }) {
-                //Move rook
-                theBoard.SetSquare({ kingRank, 0 }, Piece::NO_PIECE);
-                theBoard.SetSquare({ kingRank, 3 }, rook);
-            }
-            if (move.to == Square{ kingRank, 6 }) {
-                //Move rook
-                theBoard.SetSquare({ kingRank, 7 }, Piece::NO_PIECE);
-                theBoard.SetSquare({ kingRank, 5 }, rook);
-            }
-        }
-    }
-
-    if (theBoard(move.from) == rook) {
-        if (move.from == Square{ kingRank, 0 }) {
-            theBoard.SetCastlingRights(CastlingSide::QUEEN, false);
-        } 
-        else if (move.from == Square{ kingRank, 7 }) {
-            theBoard.SetCastlingRights(CastlingSide::KING, false);
-        }
-    }
-
-    // Check enpassent
-    if (theBoard(move.from) == pawn
-        && move.from.file != move.to.file
-        && theBoard.IsEmpty(move.to)) {
-        specialMove = SpecialMove::EN_PASSANT;
-        // Clear out captured piece 
-        theBoard.SetSquare({ move.from.rank, move.to.file }, Piece::NO_PIECE);
-    }
-
-    // Double move allows en passant on the next move
-    if (theBoard(move.from) == pawn && move.from.rank == pawnRank && move.to.rank == pawn2MoveRank) {
-        theBoard.SetEnPassentFile(move.to.file);
-    }
-    else {
-        theBoard.SetEnPassentFile(INVALID_ENPASSENT_FILE);
-    }
-
-    auto piece = theBoard(move.from);
-    auto capturedPiece = theBoard(move.to);
-
-    theBoard.SetSquare(move.from, Piece::NO_PIECE);
-    theBoard.SetSquare(move.to, piece);
-
-    if (move.to.rank == (7 - kingRank) && theBoard(move.to) == pawn) {
-        theBoard.SetSquare(move.to, queen);
-        specialMove = SpecialMove::PROMOTION;
-    }
-
-    history.push_back({ move.from, move.to, capturedPiece, specialMove, previousEnPassentFile, previousCastlingRights });
-}
-
-void UndoMove() {
-    auto move = history.back();
-    history.pop_back();
-
-    // Apply castling move
-    Piece king;
-    Piece rook;
-    Piece pawn;
-    int8_t kingRank;
-
-    if (theBoard.GetTurn() == Color::WHITE) {
-        king = Piece::WHITE_KING;
-        rook = Piece::WHITE_ROOK;
-        pawn = Piece::WHITE_PAWN;
-        kingRank = 0;
-    }
-    else {
-        king = Piece::BLACK_KING;
-        rook = Piece::BLACK_ROOK;
-        pawn = Piece::BLACK_PAWN;
-        kingRank = 7;
-    }
-
-    if (theBoard(move.to) == king && move.from == Square{ kingRank, 4 }) {
-        if (move.to == Square{ kingRank, 2 }) {
-            //Move rook
-            theBoard.SetSquare({ kingRank, 0 }, rook);
-            theBoard.SetSquare({ kingRank, 3 }, Piece::NO_PIECE);
-        }
-        if (move.to == Square{ kingRank, 6 }) {
-            //Move rook
-            theBoard.SetSquare({ kingRank, 7 }, rook);
-            theBoard.SetSquare({ kingRank, 5 }, Piece::NO_PIECE);
-        }
-    }
-
-    auto piece = theBoard(move.to);
-
-    theBoard.SetSquare(move.from, piece);
-    theBoard.SetSquare(move.to, move.capturedPiece);
-
-    switch (move.specialMove) {
-    case SpecialMove::EN_PASSANT:
-    {
-        // Place back pawn
-        auto capturedPawn = theBoard.GetTurn() == Color::WHITE ? Piece::BLACK_PAWN : Piece::WHITE_PAWN;
-        theBoard.SetSquare({ move.from.rank, move.to.file }, capturedPawn);
-        assert(move.previousEnPassentFile != INVALID_ENPASSENT_FILE);
-        break;
-    }
-
-    case SpecialMove::PROMOTION:
-        theBoard.SetSquare(move.from, pawn);
-        break;
-    }
-
-    theBoard.SetEnPassentFile(move.previousEnPassentFile);
-    theBoard.SetCastlingRights(move.previousCastlingRights);
-}
-
-void ParseBoard(Board& board, const std::string& str) {
-    if (str.length() != 64) {
-        std::cerr << "Could not parse board";
-        std::exit(1);
-    }
-
-    board.Reset();
-
-    for (int i = 0; i < 64; i++) {
-        char c = str[i];
-        auto piece = Piece::NO_PIECE;
-
-        switch (c) {
-        case 'p':
-            piece = Piece::WHITE_PAWN;
-            break;
-        case 'r':
-            piece = Piece::WHITE_ROOK;
-            break;
-        case 'n':
-            piece = Piece::WHITE_KNIGHT;
-            break;
-        case 'b':
-            piece = Piece::WHITE_BISHOP;
-            break;
-        case 'k':
-            piece = Piece::WHITE_KING;
-            break;
-        case 'q':
-            piece = Piece::WHITE_QUEEN;
-            break;
-        case 'P':
-            piece = Piece::BLACK_PAWN;
-            break;
-        case 'R':
-            piece = Piece::BLACK_ROOK;
-            break;
-        case 'N':
-            piece = Piece::BLACK_KNIGHT;
-            break;
-        case 'B':
-            piece = Piece::BLACK_BISHOP;
-            break;
-        case 'K':
-            piece = Piece::BLACK_KING;
-            break;
-        case 'Q':
-            piece = Piece::BLACK_QUEEN;
-            break;
-        }
-        int8_t rank = 7 - (i / 8);
-        int8_t file = i % 8;
-        board.SetSquare({ rank, file }, piece);
-    }
-}
-
-void ParseFENBoard(Board& board, const std::string& fen) {
-    board.Reset();
-    auto parts = Split(fen, ' ');
-
-    if (parts.size() < 5) {
-        std::cerr << "Invalid FEN board\n";
-        std::exit(1);
-    }
-
-    auto& boardStr = parts[1];
-    auto ranks = Split(boardStr, '/');
-
-    if (ranks.size() != 8) {
-        std::cerr << "Invalid FEN board, boards must have 8 ranks \n";
-        std::exit(1);
-    }
-
-    for (int8_t rank = 0; rank < 8; rank++) {
-        auto rankString = ranks[rank];
-        int8_t file = 0;
-        size_t pos = 0;
-        while (file < 8 && pos < rankString.length()) {
-            auto c = rankString[pos++];
-            if (c >= '1' && c <= '9') {
-                file += (c - '0');
-            }
-            else {
-                auto piece = Piece::NO_PIECE;
-                switch (c) {
-                case 'r':
-                    piece = Piece::BLACK_ROOK;
-                    break;
-                case 'n':
-                    piece = Piece::BLACK_KNIGHT;
-                    break;
-                case 'b':
-                    piece = Piece::BLACK_BISHOP;
-                    break;
-                case 'k':
-                    piece = Piece::BLACK_KING;
-                    break;
-                case 'q':
-                    piece = Piece::BLACK_QUEEN;
-                    break;
-                case 'p':
-                    piece = Piece::BLACK_PAWN;
-                    break;
-                case 'R':
-                    piece = Piece::WHITE_ROOK;
-                    break;
-                case 'N':
-                    piece = Piece::WHITE_KNIGHT;
-                    break;
-                case 'B':
-                    piece = Piece::WHITE_BISHOP;
-                    break;
-                case 'K':
-                    piece = Piece::WHITE_KING;
-                    break;
-                case 'Q':
-                    piece = Piece::WHITE_QUEEN;
-                    break;
-                case 'P':
-                    piece = Piece::WHITE_PAWN;
-                    break;
-                }
-                board.SetSquare(Square{ static_cast<int8_t>(7 - rank), file }, piece);
-                file++;
-            }
-        }
-    }
-
-    auto color = parts[2];
-    if (color == "w") {
-        board.SetTurn(Color::WHITE);
-    }
-    else if (color == "b") {
-        board.SetTurn(Color::BLACK);
-    }
-    else {
-        std::cerr << "Invalid FEN color\n";
-        std::exit(1);
-    }
-
-    auto castlingRights = parts[3];
-    board.SetCastlingRights(Color::WHITE, CastlingSide::KING, false);
-    board.SetCastlingRights(Color::WHITE, CastlingSide::QUEEN, false);
-    board.SetCastlingRights(Color::BLACK, CastlingSide::KING, false);
-    board.SetCastlingRights(Color::BLACK, CastlingSide::QUEEN, false);
-    for (auto c : castlingRights) {
-        switch (c) {
-        case 'K':
-            board.SetCastlingRights(Color::WHITE, CastlingSide::KING, true);
-            break;
-        case 'Q':
-            board.SetCastlingRights(Color::WHITE, CastlingSide::QUEEN, true);
-            break;
-        case 'k':
-            board.SetCastlingRights(Color::BLACK, CastlingSide::KING, true);
-            break;
-        case 'q':
-            board.SetCastlingRights(Color::BLACK, CastlingSide::QUEEN, true);
-            break;
-        }
-    }
-
-    auto enPassent = parts[4];
-    if (enPassent != "-") {
-        if (enPassent.length() != 2) {
-            std::cerr << "Invalid enpassent for fen string\n";
-            std::exit(1);
-        }
-        board.SetEnPassentFile(enPassent[0] - 'a');
-    }
-}
-
-std::string FormatFENBoard(Board& board) {
-    std::stringstream ss;
-    for (int8_t rank = 7; rank >= 0; rank--) {
-        int8_t file = 0;
-        int empty = 0;
-        for (int8_t file = 0; file < 8; file++) {
-            auto piece = board({ rank, file });
-            char c = '.';
-            switch (piece) {
-            case Piece::NO_PIECE:
-                c = '.';
-                break;
-            case Piece::WHITE_PAWN:
-                c = 'P';
-                break;
-            case Piece::WHITE_ROOK:
-                c = 'R';
-                break;
-            case Piece::WHITE_KNIGHT:
-                c = 'N';
-                break;
-            case Piece::WHITE_BISHOP:
-                c = 'B';
-                break;
-            case Piece::WHITE_QUEEN:
-                c = 'Q';
-                break;
-            case Piece::WHITE_KING:
-                c = 'K';
-                break;
-            case Piece::BLACK_PAWN:
-                c = 'p';
-                break;
-            case Piece::BLACK_ROOK:
-                c = 'r';
-                break;
-            case Piece::BLACK_KNIGHT:
-                c = 'n';
-                break;
-            case Piece::BLACK_BISHOP:
-                c = 'b';
-                break;
-            case Piece::BLACK_QUEEN:
-                c = 'q';
-                break;
-            case Piece::BLACK_KING:
-                c = 'k';
-                break;
-            }
-            if (c == '.') {
-                empty++;
-            }
-            else {
-                if (empty > 0) {
-                    ss << empty;
-                }
-                empty = 0;
-                ss << c;
-            }
-        }
-        if (empty > 0)
-            ss << empty;
-        
-        if (rank > 0)
-            ss << "/";
-    }
-
-    ss << " " << (board.GetTurn() == Color::WHITE ? "w" : "b") << " ";
-    bool rights = false;
-    if (board.HasCastlingRights(Color::WHITE, CastlingSide::KING)) {
-        rights = true;
-        ss << "K";
-    }
-    if (board.HasCastlingRights(Color::WHITE, CastlingSide::QUEEN)) {
-        rights = true;
-        ss << "Q";
-    }
-    if (board.HasCastlingRights(Color::BLACK, CastlingSide::KING)) {
-        rights = true;
-        ss << "k";
-    }
-    if (board.HasCastlingRights(Color::BLACK, CastlingSide::QUEEN)) {
-        rights = true;
-        ss << "q";
-    }
-    if (!rights) ss << "-";
-    
-    ss << " ";
-
-    if (board.GetEnPassentFile() == INVALID_ENPASSENT_FILE)
-        ss << "-";
-    else
-        ss << static_cast<char>(board.GetEnPassentFile() + 'a') << (board.GetTurn() == Color::WHITE ? '3' : '6');
-
-    return ss.str();
-}
-
-void SetDefaultBoard(Board& board) {
-    ParseBoard(board,
-        "RNBQKBNR"
-        "PPPPPPPP"
-        "........"
-        "........"
-        "........"
-        "........"
-        "pppppppp"
-        "rnbqkbnr"
-    );
-}
-
-std::string GetProtocolString(const Board& board) {
-    std::stringstream ss;
-    for (int8_t rank = 7; rank >= 0; rank--) {
-        for (int8_t file = 0; file < 8; file++) {
-            ss << board(Square{ rank, file });
-        }
-    }
-    return ss.str();
+#include <algorithm>
+#include <sstream>
+#include <vector>
+
+#include "Board.h"
+#include "Util.h"
+#include "Zobrist.h"
+
+enum class SpecialMove {
+    NORMAL_MOVE,
+    EN_PASSANT,
+    PROMOTION
+};
+
+struct HistoricMove {
+    Square from;
+    Square to;
+    Piece capturedPiece;
+    SpecialMove specialMove;
+    int8_t previousEnPassentFile;
+    int8_t previousCastlingRights;
+    int16_t previousHalfmoveClock;
+};
+
+thread_local std::vector<HistoricMove> history;
+// Hash of the position before each move, kept apart from the moves so it can be carried to other threads
+thread_local std::vector<uint64_t> hashHistory;
+
+void ClearHistory() {
+    history.clear();
+    hashHistory.clear();
+}
+
+auto GetHashHistory() -> std::vector<uint64_t> {
+    auto length = std::min<size_t>(theBoard.GetHalfmoveClock(), hashHistory.size());
+    return { hashHistory.end() - length, hashHistory.end() };
+}
+
+void SetHashHistory(const std::vector<uint64_t>& hashes) {
+    history.clear();
+    hashHistory = hashes;
+}
+
+auto IsDrawByRule(int ply) -> bool {
+    auto halfmoveClock = theBoard.GetHalfmoveClock();
+    if (halfmoveClock >= FIFTY_MOVE_RULE_PLIES) return true;
+
+    // Only positions with the same side to move since the last irreversible move can repeat
+    auto hash = theBoard.GetHash();
+    auto size = static_cast<int>(hashHistory.size());
+    auto limit = std::min<int>(halfmoveClock, size);
+    auto repetitions = 0;
+    for (int distance = 4; distance <= limit; distance += 2) {
+        if (hashHistory[size - distance] != hash) continue;
+        if (distance < ply || ++repetitions == 2) return true;
+    }
+    return false;
+}
+
+thread_local Board theBoard;
+
+template<Color Us>
+void DoMove(const Move& move) {
+    using S = Side<Us>;
+    constexpr auto kingRank = S::BACK_RANK;
+    auto specialMove = SpecialMove::NORMAL_MOVE;
+
+    auto previousEnPassentFile = theBoard.GetEnPassentFile();
+    auto previousCastlingRights = theBoard.GetCastlingRights();
+    auto previousHalfmoveClock = theBoard.GetHalfmoveClock();
+    hashHistory.push_back(theBoard.GetHash());
+
+    auto piece = theBoard(move.from);
+    auto capturedPiece = theBoard(move.to);
+
+    // Apply castling move
+    if (piece == S::KING) {
+        theBoard.SetCastlingRights(CastlingSide::KING, false);
+        theBoard.SetCastlingRights(CastlingSide::QUEEN, false);
+
+        if (move.from == Square{ kingRank, 4 }) {
+            if (move.to == Square{ kingRank, 2 }) {
+                //Move rook
+                theBoard.SetSquare({ kingRank, 0 }, Piece::NO_PIECE);
+                theBoard.SetSquare({ kingRank, 3 }, S::ROOK);
+            }
+            if (move.to == Square{ kingRank, 6 }) {
+                //Move rook
+                theBoard.SetSquare({ kingRank, 7 }, Piece::NO_PIECE);
+                theBoard.SetSquare({ kingRank, 5 }, S::ROOK);
+            }
+        }
+    }
+
+    if (piece == S::ROOK) {
+        if (move.from == Square{ kingRank, 0 }) {
+            theBoard.SetCastlingRights(CastlingSide::QUEEN, false);
+        } 
+        else if (move.from == Square{ kingRank, 7 }) {
+            theBoard.SetCastlingRights(CastlingSide::KING, false);
+        }
+    }
+
+    // Check enpassent
+    if (piece == S::PAWN
+        && move.from.file != move.to.file
+        && capturedPiece == Piece::NO_PIECE) {
+        specialMove = SpecialMove::EN_PASSANT;
+        // Clear out captured piece 
+        theBoard.SetSquare({ move.from.rank, move.to.file }, Piece::NO_PIECE);
+    }
+
+    // Double move allows en passant on the next move
+    if (piece == S::PAWN && move.from.rank == S::PAWN_RANK && move.to.rank == S::DOUBLE_PUSH_RANK) {
+        theBoard.SetEnPassentFile(move.to.file);
+    }
+    else {
+        theBoard.SetEnPassentFile(INVALID_ENPASSENT_FILE);
+    }
+
+    if (piece == S::PAWN || capturedPiece != Piece::NO_PIECE) {
+        theBoard.SetHalfmoveClock(0);
+    }
+    else {
+        theBoard.SetHalfmoveClock(previousHalfmoveClock + 1);
+    }
+
+    theBoard.SetSquare(move.from, Piece::NO_PIECE);
+    theBoard.SetSquare(move.to, piece);
+
+    if (move.to.rank == S::PROMOTION_RANK && piece == S::PAWN) {
+        theBoard.SetSquare(move.to, S::QUEEN);
+        specialMove = SpecialMove::PROMOTION;
+    }
+
+    history.push_back({ move.from, move.to, capturedPiece, specialMove, previousEnPassentFile, previousCastlingRights, previousHalfmoveClock });
+}
+
+// The side to move is dispatched once, the move code knows its pieces and ranks at compile time
+void DoMove(const Move& move) {
+    if (theBoard.GetTurn() == Color::WHITE) DoMove<Color::WHITE>(move);
+    else DoMove<Color::BLACK>(move);
+}
+
+template<Color Us>
+void UndoMove() {
+    using S = Side<Us>;
+    constexpr auto kingRank = S::BACK_RANK;
+    auto move = history.back();
+    history.pop_back();
+    hashHistory.pop_back();
+
+    // Apply castling move
+    if (theBoard(move.to) == S::KING && move.from == Square{ kingRank, 4 }) {
+        if (move.to == Square{ kingRank, 2 }) {
+            //Move rook
+            theBoard.SetSquare({ kingRank, 0 }, S::ROOK);
+            theBoard.SetSquare({ kingRank, 3 }, Piece::NO_PIECE);
+        }
+        if (move.to == Square{ kingRank, 6 }) {
+            //Move rook
+            theBoard.SetSquare({ kingRank, 7 }, S::ROOK);
+            theBoard.SetSquare({ kingRank, 5 }, Piece::NO_PIECE);
+        }
+    }
+
+    auto piece = theBoard(move.to);
+
+    theBoard.SetSquare(move.from, piece);
+    theBoard.SetSquare(move.to, move.capturedPiece);
+
+    switch (move.specialMove) {
+    case SpecialMove::EN_PASSANT:
+        // Place back pawn
+        theBoard.SetSquare({ move.from.rank, move.to.file }, Side<S::THEM>::PAWN);
+        assert(move.previousEnPassentFile != INVALID_ENPASSENT_FILE);
+        break;
+
+    case SpecialMove::PROMOTION:
+        theBoard.SetSquare(move.from, S::PAWN);
+        break;
+    }
+
+    theBoard.SetEnPassentFile(move.previousEnPassentFile);
+    // Restored one by one to keep the hash in sync, it must match the hash before the move for repetitions
+    for (auto color : { Color::WHITE, Color::BLACK }) {
+        for (auto side : { CastlingSide::QUEEN, CastlingSide::KING }) {
+            theBoard.SetCastlingRights(color, side, (move.previousCastlingRights & theBoard.GetCastlingBit(color, side)) != 0);
+        }
+    }
+    theBoard.SetHalfmoveClock(move.previousHalfmoveClock);
+}
+
+void UndoMove() {
+    if (theBoard.GetTurn() == Color::WHITE) UndoMove<Color::WHITE>();
+    else UndoMove<Color::BLACK>();
+}
+
+void ParseBoard(Board& board, const std::string& str) {
+    if (str.length() != 64) {
+        std::cerr << "Could not parse board";
+        std::exit(1);
+    }
+
+    board.Reset();
+
+    for (int i = 0; i < 64; i++) {
+        char c = str[i];
+        auto piece = Piece::NO_PIECE;
+
+        switch (c) {
+        case 'p':
+            piece = Piece::WHITE_PAWN;
+            break;
+        case 'r':
+            piece = Piece::WHITE_ROOK;
+            break;
+        case 'n':
+            piece = Piece::WHITE_KNIGHT;
+            break;
+        case 'b':
+            piece = Piece::WHITE_BISHOP;
+            break;
+        case 'k':
+            piece = Piece::WHITE_KING;
+            break;
+        case 'q':
+            piece = Piece::WHITE_QUEEN;
+            break;
+        case 'P':
+            piece = Piece::BLACK_PAWN;
+            break;
+        case 'R':
+            piece = Piece::BLACK_ROOK;
+            break;
+        case 'N':
+            piece = Piece::BLACK_KNIGHT;
+            break;
+        case 'B':
+            piece = Piece::BLACK_BISHOP;
+            break;
+        case 'K':
+            piece = Piece::BLACK_KING;
+            break;
+        case 'Q':
+            piece = Piece::BLACK_QUEEN;
+            break;
+        }
+        int8_t rank = 7 - (i / 8);
+        int8_t file = i % 8;
+        board.SetSquare({ rank, file }, piece);
+    }
+}
+
+void ParseFENBoard(Board& board, const std::string& fen) {
+    board.Reset();
+    auto parts = Split(fen, ' ');
+
+    if (parts.size() < 4) {
+        std::cerr << "Invalid FEN board\n";
+        std::exit(1);
+    }
+
+    auto& boardStr = parts[0];
+    auto ranks = Split(boardStr, '/');
+
+    if (ranks.size() != 8) {
+        std::cerr << "Invalid FEN board, boards must have 8 ranks \n";
+        std::exit(1);
+    }
+
+    for (int8_t rank = 0; rank < 8; rank++) {
+        auto rankString = ranks[rank];
+        int8_t file = 0;
+        size_t pos = 0;
+        while (file < 8 && pos < rankString.length()) {
+            auto c = rankString[pos++];
+            if (c >= '1' && c <= '9') {
+                file += (c - '0');
+            }
+            else {
+                auto piece = Piece::NO_PIECE;
+                switch (c) {
+                case 'r':
+                    piece = Piece::BLACK_ROOK;
+                    break;
+                case 'n':
+                    piece = Piece::BLACK_KNIGHT;
+                    break;
+                case 'b':
+                    piece = Piece::BLACK_BISHOP;
+                    break;
+                case 'k':
+                    piece = Piece::BLACK_KING;
+                    break;
+                case 'q':
+                    piece = Piece::BLACK_QUEEN;
+                    break;
+                case 'p':
+                    piece = Piece::BLACK_PAWN;
+                    break;
+                case 'R':
+                    piece = Piece::WHITE_ROOK;
+                    break;
+                case 'N':
+                    piece = Piece::WHITE_KNIGHT;
+                    break;
+                case 'B':
+                    piece = Piece::WHITE_BISHOP;
+                    break;
+                case 'K':
+                    piece = Piece::WHITE_KING;
+                    break;
+                case 'Q':
+                    piece = Piece::WHITE_QUEEN;
+                    break;
+                case 'P':
+                    piece = Piece::WHITE_PAWN;
+                    break;
+                }
+                board.SetSquare(Square{ static_cast<int8_t>(7 - rank), file }, piece);
+                file++;
+            }
+        }
+    }
+
+    auto color = parts[1];
+    if (color == "w") {
+        board.SetTurn(Color::WHITE);
+    }
+    else if (color == "b") {
+        board.SetTurn(Color::BLACK);
+    }
+    else {
+        std::cerr << "Invalid FEN color\n";
+        std::exit(1);
+    }
+
+    auto castlingRights = parts[2];
+    board.SetCastlingRights(Color::WHITE, CastlingSide::KING, false);
+    board.SetCastlingRights(Color::WHITE, CastlingSide::QUEEN, false);
+    board.SetCastlingRights(Color::BLACK, CastlingSide::KING, false);
+    board.SetCastlingRights(Color::BLACK, CastlingSide::QUEEN, false);
+    for (auto c : castlingRights) {
+        switch (c) {
+        case 'K':
+            board.SetCastlingRights(Color::WHITE, CastlingSide::KING, true);
+            break;
+        case 'Q':
+            board.SetCastlingRights(Color::WHITE, CastlingSide::QUEEN, true);
+            break;
+        case 'k':
+            board.SetCastlingRights(Color::BLACK, CastlingSide::KING, true);
+            break;
+        case 'q':
+            board.SetCastlingRights(Color::BLACK, CastlingSide::QUEEN, true);
+            break;
+        }
+    }
+
+    auto enPassent = parts[3];
+    if (enPassent != "-") {
+        if (enPassent.length() != 2) {
+            std::cerr << "Invalid enpassent for fen string\n";
+            std::exit(1);
+        }
+        board.SetEnPassentFile(enPassent[0] - 'a');
+    }
+
+    if (parts.size() >= 5) {
+        board.SetHalfmoveClock(static_cast<int16_t>(std::stoi(parts[4])));
+    }
+}
+
+std::string FormatFENBoard(Board& board) {
+    std::stringstream ss;
+    for (int8_t rank = 7; rank >= 0; rank--) {
+        int8_t file = 0;
+        int empty = 0;
+        for (int8_t file = 0; file < 8; file++) {
+            auto piece = board({ rank, file });
+            char c = '.';
+            switch (piece) {
+            case Piece::NO_PIECE:
+                c = '.';
+                break;
+            case Piece::WHITE_PAWN:
+                c = 'P';
+                break;
+            case Piece::WHITE_ROOK:
+                c = 'R';
+                break;
+            case Piece::WHITE_KNIGHT:
+                c = 'N';
+                break;
+            case Piece::WHITE_BISHOP:
+                c = 'B';
+                break;
+            case Piece::WHITE_QUEEN:
+                c = 'Q';
+                break;
+            case Piece::WHITE_KING:
+                c = 'K';
+                break;
+            case Piece::BLACK_PAWN:
+                c = 'p';
+                break;
+            case Piece::BLACK_ROOK:
+                c = 'r';
+                break;
+            case Piece::BLACK_KNIGHT:
+                c = 'n';
+                break;
+            case Piece::BLACK_BISHOP:
+                c = 'b';
+                break;
+            case Piece::BLACK_QUEEN:
+                c = 'q';
+                break;
+            case Piece::BLACK_KING:
+                c = 'k';
+                break;
+            }
+            if (c == '.') {
+                empty++;
+            }
+            else {
+                if (empty > 0) {
+                    ss << empty;
+                }
+                empty = 0;
+                ss << c;
+            }
+        }
+        if (empty > 0)
+            ss << empty;
+        
+        if (rank > 0)
+            ss << "/";
+    }
+
+    ss << " " << (board.GetTurn() == Color::WHITE ? "w" : "b") << " ";
+    bool rights = false;
+    if (board.HasCastlingRights(Color::WHITE, CastlingSide::KING)) {
+        rights = true;
+        ss << "K";
+    }
+    if (board.HasCastlingRights(Color::WHITE, CastlingSide::QUEEN)) {
+        rights = true;
+        ss << "Q";
+    }
+    if (board.HasCastlingRights(Color::BLACK, CastlingSide::KING)) {
+        rights = true;
+        ss << "k";
+    }
+    if (board.HasCastlingRights(Color::BLACK, CastlingSide::QUEEN)) {
+        rights = true;
+        ss << "q";
+    }
+    if (!rights) ss << "-";
+    
+    ss << " ";
+
+    if (board.GetEnPassentFile() == INVALID_ENPASSENT_FILE)
+        ss << "-";
+    else
+        ss << static_cast<char>(board.GetEnPassentFile() + 'a') << (board.GetTurn() == Color::WHITE ? '3' : '6');
+
+    return ss.str();
+}
+
+void SetDefaultBoard(Board& board) {
+    ParseBoard(board,
+        "RNBQKBNR"
+        "PPPPPPPP"
+        "........"
+        "........"
+        "........"
+        "........"
+        "pppppppp"
+        "rnbqkbnr"
+    );
+}
+
+std::string GetProtocolString(const Board& board) {
+    std::stringstream ss;
+    for (int8_t rank = 7; rank >= 0; rank--) {
+        for (int8_t file = 0; file < 8; file++) {
+            ss << board(Square{ rank, file });
+        }
+    }
+    return ss.str();
 }
\ No newline at end of file
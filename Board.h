@@ -1,221 +1,264 @@
-#pragma once
-
-#include <iostream>
-#include <cassert>
-
-#include "Square.h"
-#include "Move.h"
-#include "Piece.h"
-#include "Zobrist.h"
-
-constexpr int MAX_SCORE = 1000000;
-constexpr int8_t INVALID_ENPASSENT_FILE = 8;
-
-enum class Color : int8_t {
-    WHITE = 1,
-    NEUTRAL = 0,
-    BLACK = -1
-};
-
-enum class CastlingSide : int8_t {
-    QUEEN = 0,
-    KING = 1
-};
-
-constexpr int ColorToIndex(Color color) {
-    switch (color) {
-    case Color::WHITE: return 0;
-    case Color::BLACK: return 1;
-    }
-    assert(false);
-    return 0;
-}
-
-constexpr Color GetColorOfPiece(Piece piece) {
-    if (piece == Piece::NO_PIECE) return Color::NEUTRAL;
-    else if (piece <= Piece::WHITE_KING) return Color::WHITE;
-    else return Color::BLACK;
-}
-
-constexpr int CastlingSideToIndex(CastlingSide side) {
-    return static_cast<int>(side);
-}
-
-inline std::ostream& operator <<(std::ostream& o, Color color) {
-    switch (color) {
-    case Color::WHITE:
-        o << "WHITE";
-        break;
-    case Color::NEUTRAL:
-        o << "NEUTRAL";
-        break;
-    case Color::BLACK:
-        o << "BLACK";
-        break;
-    }
-    return o;
-}
-
-
-constexpr Color InvertColor(Color color) {
-    return static_cast<Color>(-static_cast<int8_t>(color));
-}
-
-
-class Board {
-public:
-    auto operator() (Square square) const -> const Piece& {
-        assert(square.rank * 8 + square.file < 64);
-        assert(square.rank * 8 + square.file >= 0);
-        return pieces[square.rank * 8 + square.file];
-    }
-
-    auto operator() (Square square) -> Piece& {
-        assert(square.rank * 8 + square.file < 64);
-        assert(square.rank * 8 + square.file >= 0);
-        return pieces[square.rank * 8 + square.file];
-    }
-
-    inline void Reset() {
-        for (int i = 0; i < 64; i++)
-            pieces[i] = Piece::NO_PIECE;
-        hash = 0;
-        castlingRights = 0b1111;
-        turn = Color::WHITE;
-        enPassantFile = INVALID_ENPASSENT_FILE;
-    }
-
-    auto IsEmpty(Square square) const -> bool {
-        return (*this)(square) == Piece::NO_PIECE;
-    }
-
-    auto IsWhite(Square square) const -> bool {
-        return (*this)(square) >= Piece::WHITE_PAWN && (*this)(square) < Piece::BLACK_PAWN;
-    }
-
-    auto IsCurrentPlayer(Square square) const -> bool {
-        return GetColor(square) == GetTurn();
-    }
-
-    auto IsOtherPlayer(Square square) const -> bool {
-        return GetColor(square) == InvertColor(GetTurn());
-    }
-
-    auto GetColor(Square square) const -> Color {
-        auto piece = (*this)(square);
-        if (piece == Piece::NO_PIECE) return Color::NEUTRAL;
-        else if (piece < Piece::BLACK_PAWN) return Color::WHITE;
-        else return Color::BLACK;
-    }
-
-    auto IsBlack(Square square) const -> bool {
-        return (*this)(square) >= Piece::BLACK_PAWN;
-    }
-
-    auto GetTurn() const -> Color {
-        return turn;
-    }
-
-    inline void SwitchTurn() {
-        turn = InvertColor(turn);
-        hash ^= turnHash;
-    }
-
-    void SetTurn(Color color) {
-        if (turn == color) return;
-        SwitchTurn();
-    }
-
-    auto GetHash() const -> uint64_t {
-        return hash;
-    }
-
-    inline void SetSquare(Square square, Piece piece) {
-        auto existingPiece = (*this)(square);
-        if (piece == existingPiece) return;
-        if (existingPiece != Piece::NO_PIECE) {
-            hash ^= GetZobristHash(square, existingPiece);
-        }
-        if (piece != Piece::NO_PIECE) {
-            hash ^= GetZobristHash(square, piece);
-        }
-        (*this)(square) = piece;
-    }
-
-    inline auto GetCastlingRights() const -> int8_t {
-        return castlingRights;
-    }
-
-    void SetCastlingRights(int8_t castlingRights) {
-        this->castlingRights = castlingRights;
-    }
-
-    inline auto GetCastlingBit(Color color, CastlingSide side) const -> int8_t {
-        if (color == Color::WHITE) 
-            return side == CastlingSide::QUEEN ? 0b0001 : 0b0010;
-        else
-            return side == CastlingSide::QUEEN ? 0b0100 : 0b1000;
-    }
-
-    inline auto HasCastlingRights(CastlingSide side) const -> bool {
-        return HasCastlingRights(turn, side);
-    }
-
-    inline void SetCastlingRights(CastlingSide side, bool rights) {
-        SetCastlingRights(turn, side, rights);
-    }
-
-    inline auto HasCastlingRights(Color color, CastlingSide side) const -> bool {
-        return castlingRights & GetCastlingBit(color, side);
-    }
-
-    inline void SetCastlingRights(Color color, CastlingSide side, bool rights) {
-        if (HasCastlingRights(color, side) != rights) {
-            hash ^= castlingRightsHashes[ColorToIndex(color)][CastlingSideToIndex(side)];
-            auto bit = GetCastlingBit(color, side);
-            if (rights)
-                castlingRights |= bit;
-            else
-                castlingRights &= ~bit;
-        }
-    }
-
-    void SetEnPassentFile(int8_t newEnpassantFile) {
-        if (enPassantFile != INVALID_ENPASSENT_FILE)
-            hash ^= enPassantHashes[enPassantFile];
-        if (newEnpassantFile != INVALID_ENPASSENT_FILE)
-            hash ^= enPassantHashes[newEnpassantFile];
-        enPassantFile = newEnpassantFile;
-    }
-
-    auto GetEnPassentFile() const -> int8_t {
-        return enPassantFile;
-    }
-
-private:
-    Piece pieces[64] = {};
-    Color turn = Color::WHITE;
-    uint64_t hash = 0;
-    int8_t enPassantFile = 8;
-    int8_t castlingRights;
-};
-
-inline std::ostream& operator<<(std::ostream& o, const Board& board) {
-    for (int8_t r = 7; r >= 0; r--) {
-        for (int8_t f = 0; f < 8; f++) {
-            o << board({ r, f });
-        }
-        o << "\n";
-    }
-    return o;
-}
-
-extern Board theBoard;
-
-void DoMove(const Move& move);
-void UndoMove();
-void ParseBoard(Board& board, const std::string& str);
-void ParseFENBoard(Board& board, const std::string& fen);
-std::string FormatFENBoard(Board& board);
-void SetDefaultBoard(Board& board);
+#pragma once
+
+#include <iostream>
+#include <cassert>
+#include <vector>
+
+#include "Square.h"
+#include "Move.h"
+#include "Piece.h"
+#include "Zobrist.h"
+
+constexpr int MAX_SCORE = 1000000;
+// Mates score MAX_SCORE minus the plies to the mate, scores beyond the threshold are mates
+constexpr int MATE_THRESHOLD = MAX_SCORE - 1000;
+constexpr int8_t INVALID_ENPASSENT_FILE = 8;
+// Halfmoves without a capture or pawn move after which the game is drawn
+constexpr int FIFTY_MOVE_RULE_PLIES = 100;
+
+enum class Color : int8_t {
+    WHITE = 1,
+    NEUTRAL = 0,
+    BLACK = -1
+};
+
+enum class CastlingSide : int8_t {
+    QUEEN = 0,
+    KING = 1
+};
+
+constexpr int ColorToIndex(Color color) {
+    switch (color) {
+    case Color::WHITE: return 0;
+    case Color::BLACK: return 1;
+    }
+    assert(false);
+    return 0;
+}
+
+// One for white and minus one for black pieces, without branches
+constexpr Color GetColorOfPiece(Piece piece) {
+    auto value = static_cast<uint8_t>(piece);
+    return static_cast<Color>((value != 0) - 2 * (value >> 3));
+}
+
+constexpr int CastlingSideToIndex(CastlingSide side) {
+    return static_cast<int>(side);
+}
+
+inline std::ostream& operator <<(std::ostream& o, Color color) {
+    switch (color) {
+    case Color::WHITE:
+        o << "WHITE";
+        break;
+    case Color::NEUTRAL:
+        o << "NEUTRAL";
+        break;
+    case Color::BLACK:
+        o << "BLACK";
+        break;
+    }
+    return o;
+}
+
+
+constexpr Color InvertColor(Color color) {
+    return static_cast<Color>(-static_cast<int8_t>(color));
+}
+
+// Pieces and ranks of one side, for the code that is specialized on the side to move
+template<Color Us>
+struct Side {
+    static constexpr bool IS_WHITE = Us == Color::WHITE;
+    static constexpr Color THEM = InvertColor(Us);
+    static constexpr Piece PAWN = IS_WHITE ? Piece::WHITE_PAWN : Piece::BLACK_PAWN;
+    static constexpr Piece KNIGHT = IS_WHITE ? Piece::WHITE_KNIGHT : Piece::BLACK_KNIGHT;
+    static constexpr Piece BISHOP = IS_WHITE ? Piece::WHITE_BISHOP : Piece::BLACK_BISHOP;
+    static constexpr Piece ROOK = IS_WHITE ? Piece::WHITE_ROOK : Piece::BLACK_ROOK;
+    static constexpr Piece QUEEN = IS_WHITE ? Piece::WHITE_QUEEN : Piece::BLACK_QUEEN;
+    static constexpr Piece KING = IS_WHITE ? Piece::WHITE_KING : Piece::BLACK_KING;
+    // Rank step of a pawn push
+    static constexpr int8_t FORWARD = IS_WHITE ? 1 : -1;
+    static constexpr int8_t BACK_RANK = IS_WHITE ? 0 : 7;
+    static constexpr int8_t PAWN_RANK = IS_WHITE ? 1 : 6;
+    static constexpr int8_t DOUBLE_PUSH_RANK = IS_WHITE ? 3 : 4;
+    // Rank of a pawn that can capture en passant
+    static constexpr int8_t EN_PASSANT_RANK = IS_WHITE ? 4 : 3;
+    static constexpr int8_t PROMOTION_RANK = IS_WHITE ? 7 : 0;
+};
+
+
+class Board {
+public:
+    auto operator() (Square square) const -> const Piece& {
+        assert(square.rank * 8 + square.file < 64);
+        assert(square.rank * 8 + square.file >= 0);
+        return pieces[square.rank * 8 + square.file];
+    }
+
+    auto operator() (Square square) -> Piece& {
+        assert(square.rank * 8 + square.file < 64);
+        assert(square.rank * 8 + square.file >= 0);
+        return pieces[square.rank * 8 + square.file];
+    }
+
+    inline void Reset() {
+        for (int i = 0; i < 64; i++)
+            pieces[i] = Piece::NO_PIECE;
+        hash = 0;
+        castlingRights = 0b1111;
+        turn = Color::WHITE;
+        enPassantFile = INVALID_ENPASSENT_FILE;
+        halfmoveClock = 0;
+    }
+
+    auto IsEmpty(Square square) const -> bool {
+        return (*this)(square) == Piece::NO_PIECE;
+    }
+
+    auto IsWhite(Square square) const -> bool {
+        return GetColorOfPiece((*this)(square)) == Color::WHITE;
+    }
+
+    auto IsCurrentPlayer(Square square) const -> bool {
+        return GetColor(square) == GetTurn();
+    }
+
+    auto IsOtherPlayer(Square square) const -> bool {
+        return GetColor(square) == InvertColor(GetTurn());
+    }
+
+    auto GetColor(Square square) const -> Color {
+        return GetColorOfPiece((*this)(square));
+    }
+
+    auto IsBlack(Square square) const -> bool {
+        return IsBlackPiece((*this)(square));
+    }
+
+    auto GetTurn() const -> Color {
+        return turn;
+    }
+
+    inline void SwitchTurn() {
+        turn = InvertColor(turn);
+        hash ^= turnHash;
+    }
+
+    void SetTurn(Color color) {
+        if (turn == color) return;
+        SwitchTurn();
+    }
+
+    auto GetHash() const -> uint64_t {
+        return hash;
+    }
+
+    inline void SetSquare(Square square, Piece piece) {
+        auto existingPiece = (*this)(square);
+        if (piece == existingPiece) return;
+        if (existingPiece != Piece::NO_PIECE) {
+            hash ^= GetZobristHash(square, existingPiece);
+        }
+        if (piece != Piece::NO_PIECE) {
+            hash ^= GetZobristHash(square, piece);
+        }
+        (*this)(square) = piece;
+    }
+
+    inline auto GetCastlingRights() const -> int8_t {
+        return castlingRights;
+    }
+
+    void SetCastlingRights(int8_t castlingRights) {
+        this->castlingRights = castlingRights;
+    }
+
+    inline auto GetCastlingBit(Color color, CastlingSide side) const -> int8_t {
+        if (color == Color::WHITE) 
+            return side == CastlingSide::QUEEN ? 0b0001 : 0b0010;
+        else
+            return side == CastlingSide::QUEEN ? 0b0100 : 0b1000;
+    }
+
+    inline auto HasCastlingRights(CastlingSide side) const -> bool {
+        return HasCastlingRights(turn, side);
+    }
+
+    inline void SetCastlingRights(CastlingSide side, bool rights) {
+        SetCastlingRights(turn, side, rights);
+    }
+
+    inline auto HasCastlingRights(Color color, CastlingSide side) const -> bool {
+        return castlingRights & GetCastlingBit(color, side);
+    }
+
+    inline void SetCastlingRights(Color color, CastlingSide side, bool rights) {
+        if (HasCastlingRights(color, side) != rights) {
+            hash ^= castlingRightsHashes[ColorToIndex(color)][CastlingSideToIndex(side)];
+            auto bit = GetCastlingBit(color, side);
+            if (rights)
+                castlingRights |= bit;
+            else
+                castlingRights &= ~bit;
+        }
+    }
+
+    void SetEnPassentFile(int8_t newEnpassantFile) {
+        if (enPassantFile != INVALID_ENPASSENT_FILE)
+            hash ^= enPassantHashes[enPassantFile];
+        if (newEnpassantFile != INVALID_ENPASSENT_FILE)
+            hash ^= enPassantHashes[newEnpassantFile];
+        enPassantFile = newEnpassantFile;
+    }
+
+    auto GetEnPassentFile() const -> int8_t {
+        return enPassantFile;
+    }
+
+    // Halfmoves since the last capture or pawn move
+    auto GetHalfmoveClock() const -> int16_t {
+        return halfmoveClock;
+    }
+
+    void SetHalfmoveClock(int16_t halfmoveClock) {
+        this->halfmoveClock = halfmoveClock;
+    }
+
+private:
+    Piece pieces[64] = {};
+    Color turn = Color::WHITE;
+    uint64_t hash = 0;
+    int8_t enPassantFile = 8;
+    int8_t castlingRights;
+    int16_t halfmoveClock = 0;
+};
+
+inline std::ostream& operator<<(std::ostream& o, const Board& board) {
+    for (int8_t r = 7; r >= 0; r--) {
+        for (int8_t f = 0; f < 8; f++) {
+            o << board({ r, f });
+        }
+        o << "\n";
+    }
+    return o;
+}
+
+extern thread_local Board theBoard;
+
+void DoMove(const Move& move);
+void UndoMove();
+// Forgets the moves that led to the current position, they can no longer be undone
+void ClearHistory();
+// Hashes of the positions before the moves of the history since the last capture or pawn move, oldest first
+auto GetHashHistory() -> std::vector<uint64_t>;
+// Replaces the history by positions that led to theBoard, used to continue a game on another thread
+void SetHashHistory(const std::vector<uint64_t>& hashes);
+// Whether theBoard is drawn by the fifty-move rule or by repetition. A position repeated within the last ply
+// halfmoves, which are part of the search, is a draw the first time, positions before need a second repetition.
+auto IsDrawByRule(int ply) -> bool;
+void ParseBoard(Board& board, const std::string& str);
+void ParseFENBoard(Board& board, const std::string& fen);
+std::string FormatFENBoard(Board& board);
+void SetDefaultBoard(Board& board);
 std::string GetProtocolString(const Board& board);
\ No newline at end of file
@@ -1,124 +1,228 @@
-#include <chrono>
-#include <fstream>
-#include <iostream>
-#include <random>
-#include <string>
-#include <unordered_map>
-
-#include "Board.h"
-#include "MoveGenerator.h"
-#include "Util.h"
-
-
-struct MoveAndCount {
-	Move move;
-	int count;
-};
-
-std::unordered_map<uint64_t, std::vector<MoveAndCount>> book;
-
-void RewriteBook();
-
-void ReadBook() {
-	std::ifstream is("NewBook.txt");
-	std::string line;
-
-	int count = 0;
-	uint64_t hash = 0;
-
-	auto startTime = std::chrono::high_resolution_clock::now();
-
-	while (is.good()) {
-		std::getline(is, line);
-
-		if (line.starts_with("pos")) {
-			Board board;
-
-			ParseFENBoard(board, line);
-			hash = board.GetHash();
-
-			if (book.contains(hash)) {
-				std::cerr << "Book contains duplicates\n";
-				std::cerr << line << "\n";
-				std::exit(1);
-			}
-		}
-		else if (line == "") break;
-		else {
-			auto parts = Split(line, ' ');
-			if (parts.size() != 2) {
-				std::cerr << "Invalid move line\n";
-				std::cerr << line;
-				std::exit(1);
-			}
-			auto move = ParseMove(parts[0]);
-			auto count = std::stoi(parts[1]);
-			book[hash].push_back({ move, count });
-		}
-	}
-	auto endTime = std::chrono::high_resolution_clock::now();
-	//RewriteBook();
-	//std::cout << "Book parsed in " << std::chrono::duration<double, std::milli>(endTime - startTime).count() << "\n";
-}
-
-std::random_device randomDevice;
-std::mt19937 randomGenerator(randomDevice());
-
-
-std::optional<Move> GetBookMove(const Board& board) {
-	auto it = book.find(board.GetHash());
-	if (it == book.end()) return {};
-	int total = 0;
-	for (auto& move : it->second) {
-		total += move.count;
-	}
-
-	std::uniform_int_distribution<> distribution(0, total);
-	int random = distribution(randomGenerator);
-
-	for (auto& move : it->second) {
-		if (random < move.count) {
-			return move.move;
-		}
-		else {
-			random -= move.count;
-		}
-	}
-	return {};
-}
-
-void RewriteRecursive(std::ostream& os, std::unordered_map<uint64_t, std::vector<MoveAndCount>>& newBook) {
-	auto boardWithoutEnPassent = theBoard;
-	boardWithoutEnPassent.SetEnPassentFile(INVALID_ENPASSENT_FILE);
-	auto it = book.find(boardWithoutEnPassent.GetHash());
-	if (it != book.end()) {
-
-		if (newBook.contains(theBoard.GetHash())) return;
-
-		newBook.insert({ theBoard.GetHash(), it->second });
-		if (it != book.end()) {
-			newBook.insert({ theBoard.GetHash(), it->second });
-			os << "pos " << FormatFENBoard(theBoard) << "\n";
-			for (auto& move : it->second)
-				os << MoveToUCI(move.move) << " " << move.count << "\n";
-		}
-
-		MoveList moveList;
-		GenerateMoves(theBoard, moveList);
-		for (auto& move : moveList) {
-			DoMove(move);
-			theBoard.SwitchTurn();
-			RewriteRecursive(os, newBook);
-			theBoard.SwitchTurn();
-			UndoMove();
-		}
-	}
-}
-
-void RewriteBook() {
-	SetDefaultBoard(theBoard);
-	MoveList moveList;
-	std::unordered_map<uint64_t, std::vector<MoveAndCount>> newBook;
-	std::fstream os("NewBook.txt", std::fstream::out);
-	RewriteRecursive(os, newBook);
-}
\ No newline at end of file
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <span>
+#include <string>
+#include <unordered_set>
+
+#include "Board.h"
+#include "Book.h"
+#include "MappedFile.h"
+#include "MoveGenerator.h"
+#include "Util.h"
+#include "Zobrist.h"
+
+namespace {
+	// Binary book: a header followed by fixed size entries sorted on hash, one entry per book move
+	constexpr char BOOK_MAGIC[8] = { 'C', 'H', 'E', 'S', 'S', 'B', 'K', '1' };
+
+	struct BookHeader {
+		char magic[8];
+		uint32_t zobristVersion;
+		uint32_t numEntries;
+	};
+
+	struct BookEntry {
+		uint64_t hash = 0;
+		uint32_t count = 0;
+		uint16_t move = 0;
+		uint16_t padding = 0;
+	};
+
+	static_assert(sizeof(BookHeader) == 16);
+	static_assert(sizeof(BookEntry) == 16);
+
+	MappedFile bookFile;
+	std::span<const BookEntry> book;
+
+	auto EncodeMove(Move move) -> uint16_t {
+		return static_cast<uint16_t>((move.from.rank * 8 + move.from.file) | (move.to.rank * 8 + move.to.file) << 6);
+	}
+
+	auto DecodeMove(uint16_t move) -> Move {
+		return { { static_cast<int8_t>((move >> 3) & 7), static_cast<int8_t>(move & 7) },
+			{ static_cast<int8_t>((move >> 9) & 7), static_cast<int8_t>((move >> 6) & 7) } };
+	}
+
+	auto FindBookEntries(uint64_t hash) -> std::span<const BookEntry> {
+		auto [first, last] = std::equal_range(book.begin(), book.end(), BookEntry{ hash },
+			[](const BookEntry& a, const BookEntry& b) { return a.hash < b.hash; });
+		return { first, last };
+	}
+
+	auto MapBook(const std::string& binaryFile) -> bool {
+		book = {};
+		if (!bookFile.Open(binaryFile)) return false;
+
+		auto header = reinterpret_cast<const BookHeader*>(bookFile.GetData());
+		if (bookFile.GetSize() < sizeof(BookHeader)
+			|| std::memcmp(header->magic, BOOK_MAGIC, sizeof(BOOK_MAGIC)) != 0
+			|| header->zobristVersion != ZOBRIST_VERSION
+			|| bookFile.GetSize() != sizeof(BookHeader) + header->numEntries * sizeof(BookEntry)) {
+			bookFile.Close();
+			return false;
+		}
+
+		book = { reinterpret_cast<const BookEntry*>(bookFile.GetData() + sizeof(BookHeader)), header->numEntries };
+		return true;
+	}
+
+	auto IsBookStale(const std::string& textFile, const std::string& binaryFile) -> bool {
+		std::error_code error;
+		auto binaryTime = std::filesystem::last_write_time(binaryFile, error);
+		if (error) return true;
+		auto textTime = std::filesystem::last_write_time(textFile, error);
+		// Without the text book, any binary book is better than none
+		if (error) return false;
+		return textTime > binaryTime;
+	}
+}
+
+void RewriteBook();
+
+auto WriteBook(const std::string& binaryFile, const std::vector<BookMove>& moves) -> bool {
+	std::vector<BookEntry> entries;
+	entries.reserve(moves.size());
+	for (auto& move : moves) {
+		entries.push_back({ move.hash, move.count, EncodeMove(move.move) });
+	}
+	std::stable_sort(entries.begin(), entries.end(), [](const BookEntry& a, const BookEntry& b) { return a.hash < b.hash; });
+
+	BookHeader header = {};
+	std::memcpy(header.magic, BOOK_MAGIC, sizeof(BOOK_MAGIC));
+	header.zobristVersion = ZOBRIST_VERSION;
+	header.numEntries = static_cast<uint32_t>(entries.size());
+
+	// Written next to the target and renamed, so no other process maps a half written book
+	auto tempFile = binaryFile + ".tmp";
+	{
+		std::ofstream os(tempFile, std::ios::binary | std::ios::trunc);
+		os.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		os.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(BookEntry));
+		if (!os) {
+			std::cerr << "Cannot write " << tempFile << "\n";
+			return false;
+		}
+	}
+	std::error_code error;
+	std::filesystem::rename(tempFile, binaryFile, error);
+	if (error) {
+		std::cerr << "Cannot write " << binaryFile << "\n";
+		return false;
+	}
+	return true;
+}
+
+auto CompileBook(const std::string& textFile, const std::string& binaryFile) -> bool {
+	std::ifstream is(textFile);
+	if (!is) {
+		std::cerr << "Cannot open " << textFile << "\n";
+		return false;
+	}
+
+	std::vector<BookMove> moves;
+	std::unordered_set<uint64_t> positions;
+	std::string line;
+	uint64_t hash = 0;
+
+	while (std::getline(is, line)) {
+		if (!line.empty() && line.back() == '\r') line.pop_back();
+
+		if (line.starts_with("pos")) {
+			Board board;
+
+			ParseFENBoard(board, line.substr(4));
+			hash = board.GetHash();
+
+			if (!positions.insert(hash).second) {
+				std::cerr << "Book contains duplicates\n";
+				std::cerr << line << "\n";
+				return false;
+			}
+		}
+		else if (line == "") break;
+		else {
+			auto parts = Split(line, ' ');
+			if (parts.size() != 2) {
+				std::cerr << "Invalid move line\n";
+				std::cerr << line << "\n";
+				return false;
+			}
+			moves.push_back({ hash, ParseMove(parts[0]), static_cast<uint32_t>(std::stoul(parts[1])) });
+		}
+	}
+
+	return WriteBook(binaryFile, moves);
+}
+
+void ReadBook() {
+	if (!IsBookStale(BOOK_TEXT_FILE, BOOK_FILE) && MapBook(BOOK_FILE)) return;
+
+	bookFile.Close();
+	if (!CompileBook(BOOK_TEXT_FILE, BOOK_FILE) || !MapBook(BOOK_FILE)) {
+		std::cerr << "Playing without book\n";
+	}
+	//RewriteBook();
+}
+
+// Per thread, the book is shared by the searches of the server sessions
+thread_local std::mt19937 randomGenerator(std::random_device{}());
+
+
+std::optional<Move> GetBookMove(const Board& board) {
+	auto entries = FindBookEntries(board.GetHash());
+	if (entries.empty()) return {};
+	int total = 0;
+	for (auto& entry : entries) {
+		total += entry.count;
+	}
+
+	std::uniform_int_distribution<> distribution(0, total - 1);
+	int random = distribution(randomGenerator);
+
+	for (auto& entry : entries) {
+		if (random < static_cast<int>(entry.count)) {
+			return DecodeMove(entry.move);
+		}
+		else {
+			random -= entry.count;
+		}
+	}
+	return {};
+}
+
+void RewriteRecursive(std::ostream& os, std::unordered_set<uint64_t>& newBook) {
+	auto boardWithoutEnPassent = theBoard;
+	boardWithoutEnPassent.SetEnPassentFile(INVALID_ENPASSENT_FILE);
+	auto entries = FindBookEntries(boardWithoutEnPassent.GetHash());
+	if (!entries.empty()) {
+
+		if (newBook.contains(theBoard.GetHash())) return;
+
+		newBook.insert(theBoard.GetHash());
+		os << "pos " << FormatFENBoard(theBoard) << "\n";
+		for (auto& entry : entries)
+			os << MoveToUCI(DecodeMove(entry.move)) << " " << entry.count << "\n";
+
+		MoveList moveList;
+		GenerateMoves(theBoard, moveList);
+		for (auto& move : moveList) {
+			DoMove(move);
+			theBoard.SwitchTurn();
+			RewriteRecursive(os, newBook);
+			theBoard.SwitchTurn();
+			UndoMove();
+		}
+	}
+}
+
+void RewriteBook() {
+	SetDefaultBoard(theBoard);
+	MoveList moveList;
+	std::unordered_set<uint64_t> newBook;
+	std::fstream os("NewBook.txt", std::fstream::out);
+	RewriteRecursive(os, newBook);
+}
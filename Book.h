@@ -1,9 +1,25 @@
-#pragma once
-
-#include <optional>
-
-#include "Board.h"
-#include "Move.h"
-
-void ReadBook();
-std::optional<Move> GetBookMove(const Board& board);
+#pragma once
+
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "Board.h"
+#include "Move.h"
+
+constexpr const char* BOOK_TEXT_FILE = "NewBook.txt";
+constexpr const char* BOOK_FILE = "NewBook.bin";
+
+struct BookMove {
+    uint64_t hash;
+    Move move;
+    uint32_t count;
+};
+
+// Writes the moves as binary book, the count of a move is its relative chance to be played
+auto WriteBook(const std::string& binaryFile, const std::vector<BookMove>& moves) -> bool;
+// Converts the text book to the sorted binary book that is memory mapped at runtime
+auto CompileBook(const std::string& textFile, const std::string& binaryFile) -> bool;
+// Maps the binary book, compiles it first when it is missing or older than the text book
+void ReadBook();
+std::optional<Move> GetBookMove(const Board& board);
@@ -1,102 +1,194 @@
-﻿#include <algorithm>
-#include <iostream>
-#include <numeric>
-#include <vector>
-#include <cassert>
-
-#include "Board.h"
-#include "Book.h"
-#include "Evaluate.h"
-#include "Move.h"
-#include "MoveGenerator.h"
-#include "MoveOrder.h"
-#include "Piece.h"
-#include "Search.h"
-#include "TranspositionTable.h"
-#include "UCI.h"
-#include "Zobrist.h"
-
-
-struct Config {
-    bool ComputerPlaysWhite = false;
-    bool ComputerPlaysBlack = false;
-};
-
-void PlayLoop(Config config) {
-    SetDefaultBoard(theBoard);
-    std::cout << theBoard;
-    while (true) {
-        std::cout << theBoard;
-        std::cout << EvaluateBoard(theBoard) << "\n";
-        auto turn = theBoard.GetTurn();
-        auto playComputer =
-            (turn == Color::WHITE && config.ComputerPlaysWhite) ||
-            (turn == Color::BLACK && config.ComputerPlaysBlack);
-
-        if (!playComputer) {
-            auto move = INVALID_MOVE;
-            while (move == INVALID_MOVE) {
-                std::cout << "Your move: ";
-                std::string moveString;
-                std::cin >> moveString;
-                move = ParseMove(moveString);
-                if (!IsMoveValid(theBoard, move)) {
-                    std::cout << "Invalid move\n";
-                    move = INVALID_MOVE;
-                }
-            }
-            std::cout << "Your move " << move << "\n";
-            DoMove(move);
-        }
-        else {
-            auto move = FindBestMoveInTime();
-            std::cout << "Depth reached " << depthReached << "\n";
-            std::cout << "Evaluated " << numEvaluates << " nodes\n";
-            std::cout << "Cache hits " << numCacheHits << ", misses " << numCacheMisses << "\n";
-            DoMove(move);
-            std::cout << "Computer played " << move << "\n";
-        }
-
-        theBoard.SwitchTurn();
-        if (IsInMate()) {
-            std::cout << "Mate\n";
-            return;
-        }
-    }
-}
-
-void PlayComputerVsComputer() {
-    PlayLoop({ true, true });
-}
-
-void PlayHumanVsHuman() {
-    PlayLoop({ false, false });
-}
-
-void PlayHumanVsComputer() {
-    PlayLoop({ false, true });
-}
-
-void PlayComputerVsHuman() {
-    PlayLoop({ true, false });
-}
-
-void Test();
-
-
-
-int main(int argc, char** argv) {
-    ReadBook();
-    //Test();
-    if (argc >= 2 && std::string(argv[1]) == "uci") {
-        UCILoop();
-    }
-    else {
-        //Benchmark();
-        //Test();
-        //PlayComputerVsHuman();
-        PlayHumanVsComputer();
-        //PlayHumanVsHuman();
-    }
-    return 0;
-}
+﻿#include <algorithm>
+#include <iostream>
+#include <numeric>
+#include <sstream>
+#include <thread>
+#include <vector>
+#include <cassert>
+
+#include "Analyze.h"
+#include "Bench.h"
+#include "Board.h"
+#include "Book.h"
+#include "Evaluate.h"
+#include "Match.h"
+#include "Move.h"
+#include "MoveGenerator.h"
+#include "MoveOrder.h"
+#include "PgnBook.h"
+#include "Piece.h"
+#include "Search.h"
+#include "SearchStats.h"
+#include "Tablebase.h"
+#include "TranspositionTable.h"
+#include "UCI.h"
+#include "Zobrist.h"
+
+
+struct Config {
+    bool ComputerPlaysWhite = false;
+    bool ComputerPlaysBlack = false;
+};
+
+void PlayLoop(Config config) {
+    SetDefaultBoard(theBoard);
+    std::cout << theBoard;
+    while (true) {
+        std::cout << theBoard;
+        std::cout << EvaluateBoard(theBoard) << "\n";
+        auto turn = theBoard.GetTurn();
+        auto playComputer =
+            (turn == Color::WHITE && config.ComputerPlaysWhite) ||
+            (turn == Color::BLACK && config.ComputerPlaysBlack);
+
+        if (!playComputer) {
+            auto move = INVALID_MOVE;
+            while (move == INVALID_MOVE) {
+                std::cout << "Your move: ";
+                std::string moveString;
+                std::cin >> moveString;
+                move = ParseMove(moveString);
+                if (!IsMoveValid(theBoard, move)) {
+                    std::cout << "Invalid move\n";
+                    move = INVALID_MOVE;
+                }
+            }
+            std::cout << "Your move " << move << "\n";
+            DoMove(move);
+        }
+        else {
+            auto move = FindBestMoveInTime();
+            std::cout << "Depth reached " << depthReached << "\n";
+            std::cout << "Evaluated " << searchStats.GetTotalNodes() << " nodes\n";
+            std::cout << "Cache hits " << searchStats.ttHits << ", misses " << searchStats.ttProbes - searchStats.ttHits << "\n";
+            DoMove(move);
+            std::cout << "Computer played " << move << "\n";
+        }
+
+        theBoard.SwitchTurn();
+        if (IsInMate()) {
+            std::cout << "Mate\n";
+            return;
+        }
+    }
+}
+
+void PlayComputerVsComputer() {
+    PlayLoop({ true, true });
+}
+
+void PlayHumanVsHuman() {
+    PlayLoop({ false, false });
+}
+
+void PlayHumanVsComputer() {
+    PlayLoop({ false, true });
+}
+
+void PlayComputerVsHuman() {
+    PlayLoop({ true, false });
+}
+
+void Test();
+
+
+
+int main(int argc, char** argv) {
+    if (argc >= 2 && std::string(argv[1]) == "compilebook") {
+        return CompileBook(argc >= 3 ? argv[2] : BOOK_TEXT_FILE, argc >= 4 ? argv[3] : BOOK_FILE) ? 0 : 1;
+    }
+    if (argc >= 3 && std::string(argv[1]) == "pgnbook") {
+        PgnBookOptions options;
+        options.pgnFile = argv[2];
+        if (argc >= 4) options.bookFile = argv[3];
+        if (argc >= 5) options.maxPly = std::stoi(argv[4]);
+        if (argc >= 6) options.threads = std::stoi(argv[5]);
+        if (argc >= 7) options.minGames = std::stoi(argv[6]);
+        return BuildPgnBook(options) ? 0 : 1;
+    }
+    if (argc >= 3 && std::string(argv[1]) == "tbgen") {
+        std::vector<std::string> names;
+        std::istringstream is(argv[2]);
+        for (std::string name; std::getline(is, name, ',');) {
+            names.push_back(name);
+        }
+        return GenerateTablebases(
+            names,
+            argc >= 4 ? argv[3] : DEFAULT_TABLEBASE_DIRECTORY,
+            argc >= 5 ? std::stoi(argv[4]) : 0) ? 0 : 1;
+    }
+    if (argc >= 3 && std::string(argv[1]) == "analyze") {
+        // analyze <file> followed by any of depth, nodes, movetime, threads, hash and output with their values
+        AnalyzeOptions options;
+        options.inputFile = argv[2];
+        for (int i = 3; i + 1 < argc; i += 2) {
+            std::string name = argv[i];
+            if (name == "depth") options.depth = std::stoi(argv[i + 1]);
+            else if (name == "nodes") options.nodes = std::stoull(argv[i + 1]);
+            else if (name == "movetime") options.moveTime = std::stoi(argv[i + 1]);
+            else if (name == "threads") options.threads = std::stoi(argv[i + 1]);
+            else if (name == "hash") options.hashMegabytes = std::stoi(argv[i + 1]);
+            else if (name == "output") options.outputFile = argv[i + 1];
+            else std::cerr << "Unknown option " << name << "\n";
+        }
+        LoadTablebases();
+        return Analyze(options) ? 0 : 1;
+    }
+    ReadBook();
+    LoadTablebases();
+    //Test();
+    if (argc >= 2 && std::string(argv[1]) == "uci") {
+        UCILoop();
+    }
+    else if (argc >= 2 && std::string(argv[1]) == "bench") {
+        Bench(
+            argc >= 3 ? std::stoi(argv[2]) : DEFAULT_BENCH_DEPTH,
+            argc >= 4 ? std::stoi(argv[3]) : DEFAULT_BENCH_THREADS,
+            argc >= 5 ? std::stoi(argv[4]) : DEFAULT_BENCH_HASH);
+    }
+    else if (argc >= 2 && std::string(argv[1]) == "server") {
+        // server [threads] [hash]
+        ServerLoop(
+            argc >= 3 ? std::stoi(argv[2]) : std::max(1, static_cast<int>(std::thread::hardware_concurrency())),
+            argc >= 4 ? std::stoi(argv[3]) : DEFAULT_HASH_SIZE);
+    }
+    else if (argc >= 2 && std::string(argv[1]) == "match") {
+        // match followed by any of the options with their values. enginea and engineb are command lines,
+        // optiona and optionb take Name=Value and can be repeated.
+        MatchOptions options;
+        for (int i = 2; i + 1 < argc; i += 2) {
+            std::string name = argv[i];
+            std::string value = argv[i + 1];
+            auto equals = value.find('=');
+            if (name == "enginea") options.engineA.command = value;
+            else if (name == "engineb") options.engineB.command = value;
+            else if (name == "optiona" && equals != std::string::npos) options.engineA.options.emplace_back(value.substr(0, equals), value.substr(equals + 1));
+            else if (name == "optionb" && equals != std::string::npos) options.engineB.options.emplace_back(value.substr(0, equals), value.substr(equals + 1));
+            else if (name == "games") options.games = std::stoi(value);
+            else if (name == "concurrency") options.concurrency = std::stoi(value);
+            else if (name == "hash") options.hashMegabytes = std::stoi(value);
+            else if (name == "nodes") options.nodes = std::stoull(value);
+            else if (name == "movetime") options.moveTime = std::stoi(value);
+            else if (name == "time") options.baseTime = std::stoi(value);
+            else if (name == "inc") options.increment = std::stoi(value);
+            else if (name == "ponder") options.ponder = value == "1" || value == "true";
+            else if (name == "openings") options.openingsFile = value;
+            else if (name == "plies") options.openingPlies = std::stoi(value);
+            else if (name == "maxplies") options.maxPlies = std::stoi(value);
+            else if (name == "elo0") options.elo0 = std::stod(value);
+            else if (name == "elo1") options.elo1 = std::stod(value);
+            else if (name == "alpha") options.alpha = std::stod(value);
+            else if (name == "beta") options.beta = std::stod(value);
+            else std::cerr << "Unknown option " << name << "\n";
+        }
+        if (options.nodes == 0 && options.moveTime == 0 && options.baseTime == 0) options.nodes = DEFAULT_MATCH_NODES;
+        return PlayMatch(options, argv[0]) ? 0 : 1;
+    }
+    else {
+        //Test();
+        //PlayComputerVsHuman();
+        PlayHumanVsComputer();
+        //PlayHumanVsHuman();
+    }
+    return 0;
+}
@@ -1,9 +1,9 @@
-#pragma once
-
-#include <numeric>
-
-class Direction {
-public:
-    int8_t vertical;
-    int8_t horizontal;
-};
+#pragma once
+
+#include <numeric>
+
+class Direction {
+public:
+    int8_t vertical;
+    int8_t horizontal;
+};
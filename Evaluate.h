@@ -1,5 +1,5 @@
-#pragma once
-
-#include "Board.h"
-
+#pragma once
+
+#include "Board.h"
+
 int EvaluateBoard(const Board& board);
\ No newline at end of file
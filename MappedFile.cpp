@@ -0,0 +1,92 @@
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "MappedFile.h"
+
+#ifdef _WIN32
+
+auto MappedFile::Open(const std::string& path, bool privateCopy) -> bool {
+    Close();
+    auto file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) return false;
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+        CloseHandle(file);
+        return false;
+    }
+
+    auto mapping = CreateFileMappingA(file, nullptr, privateCopy ? PAGE_WRITECOPY : PAGE_READONLY, 0, 0, nullptr);
+    if (mapping == nullptr) {
+        CloseHandle(file);
+        return false;
+    }
+
+    auto view = MapViewOfFile(mapping, privateCopy ? FILE_MAP_COPY : FILE_MAP_READ, 0, 0, 0);
+    if (view == nullptr) {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+
+    fileHandle = file;
+    mappingHandle = mapping;
+    data = static_cast<uint8_t*>(view);
+    size = static_cast<size_t>(fileSize.QuadPart);
+    this->privateCopy = privateCopy;
+    return true;
+}
+
+void MappedFile::Close() {
+    if (data) UnmapViewOfFile(data);
+    if (mappingHandle) CloseHandle(mappingHandle);
+    if (fileHandle) CloseHandle(fileHandle);
+    data = nullptr;
+    size = 0;
+    privateCopy = false;
+    mappingHandle = nullptr;
+    fileHandle = nullptr;
+}
+
+#else
+
+auto MappedFile::Open(const std::string& path, bool privateCopy) -> bool {
+    Close();
+    auto file = open(path.c_str(), O_RDONLY);
+    if (file < 0) return false;
+
+    struct stat status;
+    if (fstat(file, &status) != 0 || status.st_size == 0) {
+        close(file);
+        return false;
+    }
+
+    // The mapping stays valid after the descriptor is closed
+    auto view = privateCopy
+        ? mmap(nullptr, status.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, file, 0)
+        : mmap(nullptr, status.st_size, PROT_READ, MAP_SHARED, file, 0);
+    close(file);
+    if (view == MAP_FAILED) return false;
+
+    data = static_cast<uint8_t*>(view);
+    size = static_cast<size_t>(status.st_size);
+    this->privateCopy = privateCopy;
+    return true;
+}
+
+void MappedFile::Close() {
+    if (data) munmap(data, size);
+    data = nullptr;
+    size = 0;
+    privateCopy = false;
+}
+
+#endif
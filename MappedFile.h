@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+
+// View of a whole file, mapped into memory. Read only, unless it is opened as private copy.
+class MappedFile {
+public:
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // Takes over the mapping of the other file, which is left with the previous mapping of this one
+    MappedFile& operator=(MappedFile&& other) noexcept {
+        std::swap(data, other.data);
+        std::swap(size, other.size);
+        std::swap(privateCopy, other.privateCopy);
+#ifdef _WIN32
+        std::swap(fileHandle, other.fileHandle);
+        std::swap(mappingHandle, other.mappingHandle);
+#endif
+        return *this;
+    }
+
+    ~MappedFile() {
+        Close();
+    }
+
+    // Fails for missing and empty files. Pages of a private copy can be written, the changes stay in
+    // this process and never reach the file.
+    auto Open(const std::string& path, bool privateCopy = false) -> bool;
+    void Close();
+
+    auto IsOpen() const -> bool {
+        return data != nullptr;
+    }
+
+    auto GetData() const -> const uint8_t* {
+        return data;
+    }
+
+    // Null unless opened as private copy
+    auto GetMutableData() -> uint8_t* {
+        return privateCopy ? data : nullptr;
+    }
+
+    auto GetSize() const -> size_t {
+        return size;
+    }
+
+private:
+    uint8_t* data = nullptr;
+    size_t size = 0;
+    bool privateCopy = false;
+#ifdef _WIN32
+    void* fileHandle = nullptr;
+    void* mappingHandle = nullptr;
+#endif
+};
@@ -0,0 +1,359 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include "Board.h"
+#include "Book.h"
+#include "Match.h"
+#include "Move.h"
+#include "MoveGenerator.h"
+#include "MoveList.h"
+#include "Process.h"
+#include "Search.h"
+#include "Util.h"
+
+namespace {
+    struct Opening {
+        // Empty for the start position
+        std::string fen;
+        std::vector<std::string> moves;
+    };
+
+    enum class GameResult {
+        WHITE_WINS,
+        BLACK_WINS,
+        DRAW,
+    };
+
+    class UciEngine {
+    public:
+        auto Start(const MatchEngine& engine, const std::string& executable, int hashMegabytes) -> bool {
+            if (!process.Start(engine.command.empty() ? executable + " uci" : engine.command)) return false;
+            if (!process.WriteLine("uci") || !WaitFor("uciok")) return false;
+            process.WriteLine("setoption name Hash value " + std::to_string(hashMegabytes));
+            for (auto& [name, value] : engine.options) {
+                process.WriteLine("setoption name " + name + " value " + value);
+            }
+            return IsReady();
+        }
+
+        void Stop() {
+            process.WriteLine("quit");
+            process.Stop();
+        }
+
+        auto NewGame() -> bool {
+            StopPondering();
+            return process.WriteLine("ucinewgame") && IsReady();
+        }
+
+        // The move string of bestmove, empty when the engine died
+        auto Go(const std::string& position, const std::string& go) -> std::string {
+            if (!process.WriteLine(position) || !process.WriteLine(go)) return {};
+            return WaitForBestMove();
+        }
+
+        // The reply the engine expects to its last move, empty when it did not send one
+        auto GetExpectedReply() const -> const std::string& {
+            return expectedReply;
+        }
+
+        // Searches the position after the expected reply on the time of the opponent
+        void Ponder(const std::string& position, const std::string& go) {
+            if (process.WriteLine(position) && process.WriteLine("go ponder" + go.substr(2))) {
+                ponderMove = expectedReply;
+            }
+        }
+
+        auto GetPonderMove() const -> const std::string& {
+            return ponderMove;
+        }
+
+        // The opponent played the expected reply, the ponder search continues on the clock
+        auto PonderHit() -> std::string {
+            ponderMove.clear();
+            if (!process.WriteLine("ponderhit")) return {};
+            return WaitForBestMove();
+        }
+
+        void StopPondering() {
+            if (ponderMove.empty()) return;
+            ponderMove.clear();
+            if (process.WriteLine("stop")) WaitForBestMove();
+        }
+
+    private:
+        auto IsReady() -> bool {
+            return process.WriteLine("isready") && WaitFor("readyok");
+        }
+
+        auto WaitFor(const std::string& reply) -> bool {
+            for (std::string line; process.ReadLine(line);) {
+                if (line == reply) return true;
+            }
+            return false;
+        }
+
+        // "bestmove <move> [ponder <move>]"
+        auto WaitForBestMove() -> std::string {
+            for (std::string line; process.ReadLine(line);) {
+                std::istringstream is(line);
+                std::string token, move, ponder;
+                if (is >> token >> move && token == "bestmove") {
+                    expectedReply = is >> token >> ponder && token == "ponder" ? ponder : "";
+                    return move;
+                }
+            }
+            return {};
+        }
+
+        Process process;
+        std::string expectedReply;
+        // Move the ponder search expects, empty when not pondering
+        std::string ponderMove;
+    };
+
+    auto ReadOpenings(const std::string& file, std::vector<Opening>& openings) -> bool {
+        std::ifstream input(file);
+        if (!input) return false;
+        for (std::string line; std::getline(input, line);) {
+            // The board, turn, castling and en passant fields, EPD operations and move counters are not needed
+            std::istringstream is(line);
+            std::vector<std::string> fields;
+            for (std::string field; fields.size() < 4 && is >> field;) {
+                fields.push_back(field);
+            }
+            if (fields.size() < 4 || Split(fields[0], '/').size() != 8) continue;
+            openings.push_back({ fields[0] + " " + fields[1] + " " + fields[2] + " " + fields[3], {} });
+        }
+        return !openings.empty();
+    }
+
+    // Random lines from the book, generated up front so both games of an opening play the same line
+    auto GenerateBookOpenings(int count, int plies) -> std::vector<Opening> {
+        std::vector<Opening> openings;
+        for (int i = 0; i < count; i++) {
+            Opening opening;
+            SetDefaultBoard(theBoard);
+            ClearHistory();
+            for (int ply = 0; ply < plies; ply++) {
+                auto move = GetBookMove(theBoard);
+                if (!move) break;
+                opening.moves.push_back(MoveToUCI(*move));
+                DoMove(*move);
+                theBoard.SwitchTurn();
+            }
+            openings.push_back(opening);
+        }
+        return openings;
+    }
+
+    auto HasLegalMove() -> bool {
+        MoveList moves;
+        GenerateLegalMoves(theBoard, moves);
+        return moves.GetNumMoves() > 0;
+    }
+
+    // Bare kings or a single minor piece
+    auto IsInsufficientMaterial() -> bool {
+        int minors = 0;
+        for (int8_t rank = 0; rank < 8; rank++) {
+            for (int8_t file = 0; file < 8; file++) {
+                auto piece = theBoard({ rank, file });
+                if (piece == Piece::NO_PIECE || piece == Piece::WHITE_KING || piece == Piece::BLACK_KING) continue;
+                if (piece != Piece::WHITE_KNIGHT && piece != Piece::WHITE_BISHOP &&
+                    piece != Piece::BLACK_KNIGHT && piece != Piece::BLACK_BISHOP) return false;
+                minors++;
+            }
+        }
+        return minors <= 1;
+    }
+
+    auto Loss(Color color) -> GameResult {
+        return color == Color::WHITE ? GameResult::BLACK_WINS : GameResult::WHITE_WINS;
+    }
+
+    // Plays out the opening on theBoard of the calling thread, which adjudicates the game
+    auto PlayGame(UciEngine& white, UciEngine& black, const Opening& opening, const MatchOptions& options) -> GameResult {
+        if (opening.fen.empty()) SetDefaultBoard(theBoard);
+        else ParseFENBoard(theBoard, opening.fen);
+        ClearHistory();
+
+        auto position = opening.fen.empty() ? "position startpos moves" : "position fen " + opening.fen + " moves";
+        for (auto& moveString : opening.moves) {
+            DoMove(ParseMove(moveString));
+            theBoard.SwitchTurn();
+            position += " " + moveString;
+        }
+
+        int whiteTime = options.baseTime;
+        int blackTime = options.baseTime;
+        auto goCommand = [&]() -> std::string {
+            if (options.nodes > 0) return "go nodes " + std::to_string(options.nodes);
+            if (options.moveTime > 0) return "go movetime " + std::to_string(options.moveTime);
+            return "go wtime " + std::to_string(whiteTime) + " btime " + std::to_string(blackTime) +
+                " winc " + std::to_string(options.increment) + " binc " + std::to_string(options.increment);
+        };
+
+        std::string lastMove;
+        for (int ply = 0; ply < options.maxPlies; ply++) {
+            auto turn = theBoard.GetTurn();
+            auto& engine = turn == Color::WHITE ? white : black;
+            auto ponderHit = !engine.GetPonderMove().empty() && engine.GetPonderMove() == lastMove;
+            if (!ponderHit) engine.StopPondering();
+
+            auto startTime = std::chrono::steady_clock::now();
+            auto moveString = ponderHit ? engine.PonderHit() : engine.Go(position, goCommand());
+            auto ms = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime).count());
+
+            auto move = ParseMove(moveString);
+            if (move == INVALID_MOVE || !IsMoveValid(theBoard, move)) return Loss(turn);
+            if (options.baseTime > 0) {
+                auto& clock = turn == Color::WHITE ? whiteTime : blackTime;
+                clock -= ms;
+                if (clock < 0) return Loss(turn);
+                clock += options.increment;
+            }
+            DoMove(move);
+            theBoard.SwitchTurn();
+            position += " " + moveString;
+            lastMove = moveString;
+
+            if (!HasLegalMove()) return IsInCheck(theBoard) ? Loss(theBoard.GetTurn()) : GameResult::DRAW;
+            if (IsDrawByRule(0) || IsInsufficientMaterial()) return GameResult::DRAW;
+
+            if (options.ponder && !engine.GetExpectedReply().empty()) {
+                engine.Ponder(position + " " + engine.GetExpectedReply(), goCommand());
+            }
+        }
+        return GameResult::DRAW;
+    }
+}
+
+auto ComputeElo(int wins, int draws, int losses) -> EloEstimate {
+    auto games = static_cast<double>(wins + draws + losses);
+    if (games == 0) return { 0, 0 };
+    auto score = (wins + draws / 2.0) / games;
+    auto variance = (wins + draws / 4.0) / games - score * score;
+    auto deviation = 1.959964 * std::sqrt(variance / games);
+    auto toElo = [](double score) {
+        score = std::clamp(score, 1e-6, 1 - 1e-6);
+        return 400 * std::log10(score / (1 - score));
+    };
+    return { toElo(score), (toElo(score + deviation) - toElo(score - deviation)) / 2 };
+}
+
+auto ComputeSprtLLR(int wins, int draws, int losses, double elo0, double elo1) -> double {
+    auto games = static_cast<double>(wins + draws + losses);
+    if (games == 0) return 0;
+    auto score = (wins + draws / 2.0) / games;
+    auto variance = (wins + draws / 4.0) / games - score * score;
+    if (variance <= 0) return 0;
+    auto expectedScore = [](double elo) {
+        return 1 / (1 + std::pow(10, -elo / 400));
+    };
+    auto score0 = expectedScore(elo0);
+    auto score1 = expectedScore(elo1);
+    return (score1 - score0) * (2 * score - score0 - score1) / (2 * variance / games);
+}
+
+auto PlayMatch(const MatchOptions& options, const std::string& executable) -> bool {
+    std::vector<Opening> openings;
+    if (!options.openingsFile.empty()) {
+        if (!ReadOpenings(options.openingsFile, openings)) {
+            std::cerr << "Cannot read openings from " << options.openingsFile << "\n";
+            return false;
+        }
+    }
+    else {
+        openings = GenerateBookOpenings((options.games + 1) / 2, options.openingPlies);
+    }
+
+    auto sprt = options.elo1 > options.elo0;
+    auto lowerBound = std::log(options.beta / (1 - options.alpha));
+    auto upperBound = std::log((1 - options.beta) / options.alpha);
+
+    auto concurrency = options.concurrency > 0 ? options.concurrency : std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    concurrency = std::min(concurrency, options.games);
+    auto startTime = std::chrono::steady_clock::now();
+
+    // Games are handed out in order, so both colors of an opening are played close together
+    std::atomic<int> nextGame = 0;
+    std::atomic<bool> stopped = false;
+    std::mutex resultMutex;
+    int wins = 0;
+    int draws = 0;
+    int losses = 0;
+    bool failed = false;
+
+    auto report = [&]() {
+        auto games = wins + draws + losses;
+        auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+        auto elo = ComputeElo(wins, draws, losses);
+        std::cout << std::fixed << std::setprecision(1)
+            << "Games " << games << ": +" << wins << " -" << losses << " =" << draws
+            << ", Elo " << elo.elo << " +/- " << elo.margin;
+        if (sprt) {
+            std::cout << std::setprecision(2) << ", LLR " << ComputeSprtLLR(wins, draws, losses, options.elo0, options.elo1)
+                << " (" << lowerBound << ", " << upperBound << ")";
+        }
+        std::cout << std::setprecision(2) << ", " << games / std::max(seconds, 1e-3) << " games/s" << std::endl;
+    };
+
+    std::vector<std::thread> workers;
+    for (int i = 0; i < concurrency; i++) {
+        workers.emplace_back([&]() {
+            UciEngine engineA;
+            UciEngine engineB;
+            if (!engineA.Start(options.engineA, executable, options.hashMegabytes) ||
+                !engineB.Start(options.engineB, executable, options.hashMegabytes)) {
+                std::lock_guard lock(resultMutex);
+                std::cerr << "Cannot start engines\n";
+                failed = true;
+                stopped = true;
+                return;
+            }
+            while (!stopped) {
+                auto game = nextGame++;
+                if (game >= options.games) break;
+                auto& opening = openings[(game / 2) % openings.size()];
+                auto aIsWhite = game % 2 == 0;
+                engineA.NewGame();
+                engineB.NewGame();
+                auto result = aIsWhite ? PlayGame(engineA, engineB, opening, options) : PlayGame(engineB, engineA, opening, options);
+
+                std::lock_guard lock(resultMutex);
+                if (result == GameResult::DRAW) draws++;
+                else if ((result == GameResult::WHITE_WINS) == aIsWhite) wins++;
+                else losses++;
+                report();
+                if (sprt) {
+                    auto llr = ComputeSprtLLR(wins, draws, losses, options.elo0, options.elo1);
+                    if (llr <= lowerBound || llr >= upperBound) stopped = true;
+                }
+            }
+            engineA.Stop();
+            engineB.Stop();
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    if (failed) return false;
+
+    report();
+    if (sprt) {
+        auto llr = ComputeSprtLLR(wins, draws, losses, options.elo0, options.elo1);
+        std::cout << "SPRT elo0 " << options.elo0 << " elo1 " << options.elo1 << ": "
+            << (llr >= upperBound ? "H1 accepted" : llr <= lowerBound ? "H0 accepted" : "inconclusive") << "\n";
+    }
+    return true;
+}
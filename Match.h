@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+constexpr int DEFAULT_MATCH_GAMES = 1000;
+constexpr int DEFAULT_MATCH_HASH = 16;
+constexpr int DEFAULT_MATCH_NODES = 20000;
+constexpr int DEFAULT_MATCH_OPENING_PLIES = 8;
+constexpr int DEFAULT_MATCH_MAX_PLIES = 400;
+
+struct MatchEngine {
+    // Empty starts this executable in UCI mode
+    std::string command;
+    // Sent as setoption after the hash size
+    std::vector<std::pair<std::string, std::string>> options;
+};
+
+struct MatchOptions {
+    MatchEngine engineA;
+    MatchEngine engineB;
+    int games = DEFAULT_MATCH_GAMES;
+    // Games played at the same time, zero uses all cores
+    int concurrency = 0;
+    int hashMegabytes = DEFAULT_MATCH_HASH;
+    // Either nodes or move time per move, or a clock of base time plus increment in milliseconds
+    uint64_t nodes = 0;
+    int moveTime = 0;
+    int baseTime = 0;
+    int increment = 0;
+    // Engines search the expected reply on the time of the opponent, which needs two cores per game
+    bool ponder = false;
+    // EPD or FEN file, without one the openings are random lines from the book
+    std::string openingsFile;
+    int openingPlies = DEFAULT_MATCH_OPENING_PLIES;
+    // Longer games are adjudicated as draw
+    int maxPlies = DEFAULT_MATCH_MAX_PLIES;
+    // The SPRT tests elo0 against elo1 and is skipped when elo1 is not above elo0
+    double elo0 = 0;
+    double elo1 = 5;
+    double alpha = 0.05;
+    double beta = 0.05;
+};
+
+struct EloEstimate {
+    double elo;
+    // Half width of the 95% confidence interval
+    double margin;
+};
+
+// Elo difference of the wins, draws and losses of the first engine
+auto ComputeElo(int wins, int draws, int losses) -> EloEstimate;
+// Log likelihood ratio of elo1 against elo0, with the normal approximation of the trinomial distribution
+auto ComputeSprtLLR(int wins, int draws, int losses, double elo0, double elo1) -> double;
+
+// Plays engine A against engine B as child processes, every opening twice with the colors swapped.
+// Stops when all games are played or the SPRT accepts one of its hypotheses.
+auto PlayMatch(const MatchOptions& options, const std::string& executable) -> bool;
@@ -0,0 +1,222 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Bench.h"
+#include "Board.h"
+#include "Evaluate.h"
+#include "MoveGenerator.h"
+#include "MoveOrder.h"
+#include "TranspositionTable.h"
+
+// Measures the cost of the individual primitives of the engine on a corpus of positions.
+// Usage: MicroBench [fen file] [samples]
+// Without a file the positions of the bench command are used.
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    constexpr int DEFAULT_SAMPLES = 10;
+    constexpr auto WARMUP_TIME = std::chrono::milliseconds(200);
+    constexpr auto SAMPLE_TIME = std::chrono::milliseconds(100);
+    constexpr int NUM_RANDOM_HASHES = 1 << 16;
+
+    // Results are accumulated here, so the compiler cannot drop the measured calls
+    volatile uint64_t sink = 0;
+
+    struct Position {
+        std::string fen;
+        Board board;
+        MoveList moves;
+    };
+
+    auto ReadPositions(const std::string& fileName) -> std::vector<std::string> {
+        std::vector<std::string> fens;
+        std::ifstream file(fileName);
+        std::string line;
+        while (std::getline(file, line)) {
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            if (line.empty() || line[0] == '#') continue;
+            fens.push_back(line);
+        }
+        return fens;
+    }
+
+    auto ElapsedNs(Clock::time_point start) -> double {
+        return static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count());
+    }
+
+    // Runs the batch until the warmup time has passed, uses that to size the samples,
+    // then prints the median, min, max and standard deviation of the time per operation over all samples
+    void Measure(const std::string& name, int64_t opsPerBatch, int numSamples, const std::function<void()>& batch) {
+        int64_t warmupBatches = 0;
+        auto warmupStart = Clock::now();
+        while (Clock::now() - warmupStart < WARMUP_TIME) {
+            batch();
+            warmupBatches++;
+        }
+        auto nsPerBatch = ElapsedNs(warmupStart) / warmupBatches;
+        auto batchesPerSample = std::max<int64_t>(1, static_cast<int64_t>(std::chrono::nanoseconds(SAMPLE_TIME).count() / nsPerBatch));
+
+        std::vector<double> samples;
+        for (int i = 0; i < numSamples; i++) {
+            auto start = Clock::now();
+            for (int64_t j = 0; j < batchesPerSample; j++) {
+                batch();
+            }
+            samples.push_back(ElapsedNs(start) / (batchesPerSample * opsPerBatch));
+        }
+
+        std::sort(samples.begin(), samples.end());
+        auto mean = std::accumulate(samples.begin(), samples.end(), 0.0) / samples.size();
+        auto variance = 0.0;
+        for (auto sample : samples) variance += (sample - mean) * (sample - mean);
+        auto stddev = std::sqrt(variance / samples.size());
+        auto median = samples[samples.size() / 2];
+
+        std::cout << std::left << std::setw(28) << name << std::right << std::fixed << std::setprecision(1)
+            << std::setw(10) << median
+            << std::setw(10) << samples.front()
+            << std::setw(10) << samples.back()
+            << std::setw(10) << stddev
+            << std::setw(12) << std::setprecision(2) << 1000.0 / median << "\n";
+    }
+}
+
+int main(int argc, char** argv) {
+    auto fens = argc >= 2 ? ReadPositions(argv[1]) : GetBenchPositions();
+    auto numSamples = argc >= 3 ? std::stoi(argv[2]) : DEFAULT_SAMPLES;
+    if (fens.empty()) {
+        std::cout << "No positions" << std::endl;
+        return 1;
+    }
+
+    std::vector<Position> positions(fens.size());
+    int64_t totalMoves = 0;
+    for (size_t i = 0; i < fens.size(); i++) {
+        positions[i].fen = fens[i];
+        ParseFENBoard(positions[i].board, fens[i]);
+        GenerateMoves(positions[i].board, positions[i].moves);
+        totalMoves += positions[i].moves.GetNumMoves();
+    }
+    int64_t numPositions = positions.size();
+
+    // The positions one move deeper, many more than the legal move cache holds, so looking them up in turn misses it
+    std::vector<Board> children;
+    for (auto& position : positions) {
+        for (auto move : position.moves) {
+            theBoard = position.board;
+            DoMove(move);
+            theBoard.SwitchTurn();
+            if (!CanCaptureKing(theBoard)) children.push_back(theBoard);
+        }
+    }
+    int64_t numChildren = children.size();
+
+    std::cout << positions.size() << " positions, " << totalMoves << " moves, " << numSamples << " samples\n";
+    std::cout << std::left << std::setw(28) << "primitive" << std::right
+        << std::setw(10) << "ns/op" << std::setw(10) << "min" << std::setw(10) << "max"
+        << std::setw(10) << "stddev" << std::setw(12) << "Mops/s" << "\n";
+
+    Measure("ParseFENBoard", numPositions, numSamples, [&]() {
+        Board board;
+        for (auto& position : positions) {
+            ParseFENBoard(board, position.fen);
+            sink = sink + board.GetHash();
+        }
+    });
+
+    Measure("GenerateMoves", numPositions, numSamples, [&]() {
+        for (auto& position : positions) {
+            MoveList moves;
+            GenerateMoves(position.board, moves);
+            sink = sink + moves.GetNumMoves();
+        }
+    });
+
+    Measure("GenerateMoves (no castling)", numPositions, numSamples, [&]() {
+        for (auto& position : positions) {
+            MoveList moves;
+            GenerateMoves(position.board, moves, false);
+            sink = sink + moves.GetNumMoves();
+        }
+    });
+
+    Measure("DoMove+UndoMove", totalMoves, numSamples, [&]() {
+        for (auto& position : positions) {
+            theBoard = position.board;
+            for (auto move : position.moves) {
+                DoMove(move);
+                UndoMove();
+            }
+            sink = sink + theBoard.GetHash();
+        }
+    });
+
+    Measure("EvaluateBoard", numPositions, numSamples, [&]() {
+        for (auto& position : positions) {
+            sink = sink + EvaluateBoard(position.board);
+        }
+    });
+
+    Measure("IsInCheck", numPositions, numSamples, [&]() {
+        for (auto& position : positions) {
+            theBoard = position.board;
+            sink = sink + IsInCheck(theBoard);
+        }
+    });
+
+    // After the warmup every position is in the cache, this is the cost of a hit
+    Measure("GenerateLegalMoves (cached)", numPositions, numSamples, [&]() {
+        for (auto& position : positions) {
+            MoveList moves;
+            GenerateLegalMoves(position.board, moves);
+            sink = sink + moves.GetNumMoves();
+        }
+    });
+
+    Measure("GenerateLegalMoves (miss)", numChildren, numSamples, [&]() {
+        for (auto& board : children) {
+            MoveList moves;
+            GenerateLegalMoves(board, moves);
+            sink = sink + moves.GetNumMoves();
+        }
+    });
+
+    Measure("OrderMoves", numPositions, numSamples, [&]() {
+        for (auto& position : positions) {
+            auto moves = position.moves;
+            std::array<int, 128> indices;
+            std::iota(indices.begin(), indices.begin() + moves.GetNumMoves(), 0);
+            Killers noKillers;
+            OrderMoves(position.board, moves, indices, INVALID_MOVE, noKillers);
+            sink = sink + indices[0];
+        }
+    });
+
+    // Random keys, so the probes of larger tables miss the caches like they do in a search
+    std::vector<uint64_t> hashes(NUM_RANDOM_HASHES);
+    std::mt19937_64 random(12345);
+    for (auto& hash : hashes) hash = random();
+
+    for (auto megabytes : { 1, 16, 128, DEFAULT_HASH_SIZE }) {
+        ResizeTranspositionTable(megabytes);
+        ClearTranspositionTable();
+        Measure("GetEntry (" + std::to_string(megabytes) + " MB)", NUM_RANDOM_HASHES, numSamples, [&]() {
+            for (auto hash : hashes) {
+                sink = sink + GetEntry(hash)->depth;
+            }
+        });
+    }
+
+    std::cout << std::flush;
+    return 0;
+}
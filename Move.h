@@ -1,25 +1,25 @@
-#pragma once
-
-#include <ostream>
-
-#include "Square.h"
-
-class Move {
-public:
-    Square from;
-    Square to;
-
-    auto operator==(const Move& other) const -> bool {
-        return other.from == from && other.to == to;
-    }
-};
-
-constexpr Move INVALID_MOVE = { {0,0}, {0,0} };
-
-inline std::ostream& operator<<(std::ostream& o, const Move& move) {
-    return o << move.from << " -> " << move.to;
-}
-
-std::string MoveToUCI(const Move& move);
-
+#pragma once
+
+#include <ostream>
+
+#include "Square.h"
+
+class Move {
+public:
+    Square from;
+    Square to;
+
+    auto operator==(const Move& other) const -> bool {
+        return other.from == from && other.to == to;
+    }
+};
+
+constexpr Move INVALID_MOVE = { {0,0}, {0,0} };
+
+inline std::ostream& operator<<(std::ostream& o, const Move& move) {
+    return o << move.from << " -> " << move.to;
+}
+
+std::string MoveToUCI(const Move& move);
+
 auto ParseMove(const std::string& moveString) -> Move;
\ No newline at end of file
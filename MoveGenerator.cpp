@@ -1,292 +1,306 @@
-#include <iostream>
-
-#include "MoveGenerator.h"
-
-#define GEN_MOVE(target) moves.AddMove({ from, target })
-
-void GeneratePawnMoves(const Board& board, MoveList& moves, Square from) {
-    auto pushDir = (board.GetTurn() == Color::WHITE) ? Direction{1, 0} : Direction{-1, 0};
-    uint8_t enPassantRank = (board.GetTurn() == Color::WHITE) ? 4 : 3;
-    auto up1 = from.Add(pushDir);
-    if (board.IsEmpty(up1)) {
-        if (from.rank == 6) {
-            // Special treat promotion
-        }
-        moves.AddMove({ from, up1 });
-        int8_t startRank = (board.GetTurn() == Color::WHITE) ? 1 : 6;
-        if (from.rank == startRank) {
-            auto up2 = up1.Add(pushDir);
-            if (board(up2) == Piece::NO_PIECE)
-                GEN_MOVE(up2);
-        }
-    }
-
-    // Capturing moves
-    if (from.file > 0) {
-        auto left = up1.Add(0, -1);
-        if (board.IsOtherPlayer(left) ||
-            (left.file == board.GetEnPassentFile() && from.rank == enPassantRank)) {
-            GEN_MOVE(left);
-        }
-    }
-    if (from.file < 7) {
-        auto right = up1.Add(0, 1);
-        if (board.IsOtherPlayer(right) ||
-            (right.file == board.GetEnPassentFile() && from.rank == enPassantRank)) {
-            GEN_MOVE(right);
-        }
-    }
-}
-
-Direction knightMoves[8] = {
-    {-1, -2},
-    {-2, -1},
-    {1, -2},
-    {2, -1},
-    {1, 2},
-    {2, 1},
-    {-1, 2},
-    {-2, 1}
-};
-
-void GenerateKnightMoves(const Board& board, MoveList& moves, Square from) {
-    for (int i = 0; i < 8; i++) {
-        auto to = from.Add(knightMoves[i]);
-        if (to.IsValid() && !board.IsCurrentPlayer(to)) {
-            GEN_MOVE(to);
-        }
-    }
-}
-
-Direction bishopDirections[] = {
-    {-1, -1},
-    {1, -1},
-    {1, 1},
-    {-1, 1}
-};
-
-void GenerateBishopMoves(const Board& board, MoveList& moves, Square from) {
-    for (int i = 0; i < 4; i++) {
-        auto direction = bishopDirections[i];
-        auto to = from;
-        while (true) {
-            to = to.Add(direction);
-            if (!to.IsValid()) break;
-            if (board.IsCurrentPlayer(to)) break;
-            GEN_MOVE(to);
-            if (board.IsOtherPlayer(to)) break;
-        }
-    }
-}
-
-Direction rookDirections[] = {
-    {0, 1},
-    {1, 0},
-    {-1, 0},
-    {0, -1}
-};
-
-void GenerateRookMoves(const Board& board, MoveList& moves, Square from) {
-    for (int i = 0; i < 4; i++) {
-        auto direction = rookDirections[i];
-        auto to = from;
-        while (true) {
-            to = to.Add(direction);
-            if (!to.IsValid()) break;
-            if (board.IsCurrentPlayer(to)) break;
-            GEN_MOVE(to);
-            if (board.IsOtherPlayer(to)) break;
-        }
-    }
-}
-
-void GenerateQueenMoves(const Board& board, MoveList& moves, Square from) {
-    GenerateBishopMoves(board, moves, from);
-    GenerateRookMoves(board, moves, from);
-}
-
-Direction kingDirections[] = {
-    {0, 1},
-    {1, 0},
-    {-1, 0},
-    {0, -1},
-    {-1, -1},
-    {1, -1},
-    {1, 1},
-    {-1, 1}
-};
-
-class BitBoard {
-public:
-
-    static inline auto GetBit(Square s) -> uint64_t {
-        return static_cast<uint64_t>(1) << (s.rank * 8 + s.file);
-    }
-
-    inline void Set(Square s) {
-        bits |= GetBit(s);
-    }
-
-    inline auto IsSet(Square s) const -> bool {
-        return bits & GetBit(s);
-    }
-
-    inline auto IsZero() const -> bool {
-        return bits == 0;
-    }
-
-private:
-    uint64_t bits = 0;
-};
-
-auto GenerateAttacks(const Board& board) -> BitBoard {
-    BitBoard bitBoard;
-    MoveList moves;
-    GenerateMoves(board, moves, false);
-    for (const auto& m : moves) {
-        bitBoard.Set(m.to);
-    }
-    return bitBoard;
-}
-
-void GenerateKingMoves(const Board& board, MoveList& moves, Square from, bool generateCastling) {
-    for (int i = 0; i < 8; i++) {
-        Square to = from.Add(kingDirections[i]);
-        if (to.IsValid() && !board.IsCurrentPlayer(to)) {
-            GEN_MOVE(to);
-        }
-    }
-
-    if (!generateCastling) return;
-    //Castling
-    int8_t r;
-    Piece rook;
-    
-    if (board.GetTurn() == Color::WHITE) {
-        r = 0;
-        rook = Piece::WHITE_ROOK;
-    }
-    else {
-        r = 7;
-        rook = Piece::BLACK_ROOK;
-    }
-    BitBoard attacks;
-
-    if (from == Square{ r, 4 }) {
-        if (board({ r, 0 }) == rook
-            && board({ r, 1 }) == Piece::NO_PIECE
-            && board({ r, 2 }) == Piece::NO_PIECE
-            && board({ r, 3 }) == Piece::NO_PIECE
-            && board.HasCastlingRights(CastlingSide::QUEEN)) {
-
-            Board nextBoard = board;
-            nextBoard.SwitchTurn();
-            attacks = GenerateAttacks(nextBoard);
-            if (!attacks.IsSet({ r, 2 })
-                && !attacks.IsSet({ r, 3 })
-                && !attacks.IsSet({ r, 4 })) {
-                Square to = { r, 2 };
-                GEN_MOVE(to);
-            }
-        }
-        if (board({ r, 7 }) == rook
-            && board({ r, 5 }) == Piece::NO_PIECE
-            && board({ r, 6 }) == Piece::NO_PIECE 
-            && board.HasCastlingRights(CastlingSide::KING)) {
-
-            if (attacks.IsZero()) {
-                Board nextBoard = board;
-                nextBoard.SwitchTurn();
-                attacks = GenerateAttacks(nextBoard);
-            }
-            if (!attacks.IsSet({ r, 4 })
-                && !attacks.IsSet({ r, 5 })
-                && !attacks.IsSet({ r, 6 })) {
-                Square to = { r, 6 };
-                GEN_MOVE(to);
-            }
-        }
-    }
-}
-
-void GenerateMoves(const Board& board, MoveList& moves, bool generateCastling) {
-    for (int8_t r = 7; r >= 0; r--) {
-        for (int8_t f = 0; f < 8; f++) {
-            auto square = Square{ r, f };
-            if (board.GetTurn() == Color::WHITE) {
-                switch (board(square)) {
-                case Piece::WHITE_PAWN:
-                    GeneratePawnMoves(board, moves, square);
-                    break;
-                case Piece::WHITE_ROOK:
-                    GenerateRookMoves(board, moves, square);
-                    break;
-                case Piece::WHITE_KNIGHT:
-                    GenerateKnightMoves(board, moves, square);
-                    break;
-                case Piece::WHITE_BISHOP:
-                    GenerateBishopMoves(board, moves, square);
-                    break;
-                case Piece::WHITE_QUEEN:
-                    GenerateQueenMoves(board, moves, square);
-                    break;
-                case Piece::WHITE_KING:
-                    GenerateKingMoves(board, moves, square, generateCastling);
-                    break;
-                }
-            }
-            else {
-                switch (board(square)) {
-                case Piece::BLACK_PAWN:
-                    GeneratePawnMoves(board, moves, square);
-                    break;
-                case Piece::BLACK_ROOK:
-                    GenerateRookMoves(board, moves, square);
-                    break;
-                case Piece::BLACK_KNIGHT:
-                    GenerateKnightMoves(board, moves, square);
-                    break;
-                case Piece::BLACK_BISHOP:
-                    GenerateBishopMoves(board, moves, square);
-                    break;
-                case Piece::BLACK_QUEEN:
-                    GenerateQueenMoves(board, moves, square);
-                    break;
-                case Piece::BLACK_KING:
-                    GenerateKingMoves(board, moves, square, generateCastling);
-                    break;
-                }
-            }
-        }
-    }
-}
-
-auto IsInCheck(Board& board) -> bool {
-    board.SwitchTurn();
-    MoveList moves;
-    GenerateMoves(board, moves);
-    for (auto& move : moves) {
-        if (board.GetTurn() == Color::WHITE && board(move.to) == Piece::BLACK_KING ||
-            board.GetTurn() == Color::BLACK && board(move.to) == Piece::WHITE_KING) {
-            board.SwitchTurn();
-            return true;
-        }
-    }
-    board.SwitchTurn();
-    return false;
-}
-
-auto IsMoveValid(const Board& board, const Move& move) -> bool {
-    MoveList moves;
-    GenerateMoves(board, moves);
-    bool found = false;
-    for (const Move& m : moves) {
-        if (m == move) found = true;
-    }
-    if (!found) return false;
-    // We cannot set ourselves in check
-    DoMove(move);
-    auto valid = !IsInCheck(theBoard);
-    UndoMove();
-    return valid;
-}
+#include <array>
+#include <iostream>
+#include <utility>
+
+#include "MoveGenerator.h"
+
+#define GEN_MOVE(target) moves.AddMove({ from, target })
+
+template<Color Us>
+void GeneratePawnMoves(const Board& board, MoveList& moves, Square from) {
+    using S = Side<Us>;
+    auto up1 = from.Add(S::FORWARD, 0);
+    if (board.IsEmpty(up1)) {
+        moves.AddMove({ from, up1 });
+        if (from.rank == S::PAWN_RANK) {
+            auto up2 = up1.Add(S::FORWARD, 0);
+            if (board(up2) == Piece::NO_PIECE)
+                GEN_MOVE(up2);
+        }
+    }
+
+    // Capturing moves
+    if (from.file > 0) {
+        auto left = up1.Add(0, -1);
+        if (board.GetColor(left) == S::THEM ||
+            (left.file == board.GetEnPassentFile() && from.rank == S::EN_PASSANT_RANK)) {
+            GEN_MOVE(left);
+        }
+    }
+    if (from.file < 7) {
+        auto right = up1.Add(0, 1);
+        if (board.GetColor(right) == S::THEM ||
+            (right.file == board.GetEnPassentFile() && from.rank == S::EN_PASSANT_RANK)) {
+            GEN_MOVE(right);
+        }
+    }
+}
+
+constexpr Direction knightMoves[8] = {
+    {-1, -2},
+    {-2, -1},
+    {1, -2},
+    {2, -1},
+    {1, 2},
+    {2, 1},
+    {-1, 2},
+    {-2, 1}
+};
+
+template<Color Us>
+void GenerateKnightMoves(const Board& board, MoveList& moves, Square from) {
+    for (int i = 0; i < 8; i++) {
+        auto to = from.Add(knightMoves[i]);
+        if (to.IsValid() && board.GetColor(to) != Us) {
+            GEN_MOVE(to);
+        }
+    }
+}
+
+constexpr Direction bishopDirections[] = {
+    {-1, -1},
+    {1, -1},
+    {1, 1},
+    {-1, 1}
+};
+
+constexpr Direction rookDirections[] = {
+    {0, 1},
+    {1, 0},
+    {-1, 0},
+    {0, -1}
+};
+
+template<Color Us>
+void GenerateSliderMoves(const Board& board, MoveList& moves, Square from, const Direction* directions) {
+    for (int i = 0; i < 4; i++) {
+        auto direction = directions[i];
+        auto to = from;
+        while (true) {
+            to = to.Add(direction);
+            if (!to.IsValid()) break;
+            auto color = board.GetColor(to);
+            if (color == Us) break;
+            GEN_MOVE(to);
+            if (color != Color::NEUTRAL) break;
+        }
+    }
+}
+
+constexpr Direction kingDirections[] = {
+    {0, 1},
+    {1, 0},
+    {-1, 0},
+    {0, -1},
+    {-1, -1},
+    {1, -1},
+    {1, 1},
+    {-1, 1}
+};
+
+template<Color Us>
+void GenerateKingMoves(const Board& board, MoveList& moves, Square from, bool generateCastling) {
+    using S = Side<Us>;
+    for (int i = 0; i < 8; i++) {
+        Square to = from.Add(kingDirections[i]);
+        if (to.IsValid() && board.GetColor(to) != Us) {
+            GEN_MOVE(to);
+        }
+    }
+
+    if (!generateCastling) return;
+    //Castling
+    constexpr int8_t r = S::BACK_RANK;
+
+    if (from == Square{ r, 4 }) {
+        if (board({ r, 0 }) == S::ROOK
+            && board({ r, 1 }) == Piece::NO_PIECE
+            && board({ r, 2 }) == Piece::NO_PIECE
+            && board({ r, 3 }) == Piece::NO_PIECE
+            && board.HasCastlingRights(CastlingSide::QUEEN)
+            && !IsSquareAttacked(board, { r, 2 }, S::THEM)
+            && !IsSquareAttacked(board, { r, 3 }, S::THEM)
+            && !IsSquareAttacked(board, { r, 4 }, S::THEM)) {
+            Square to = { r, 2 };
+            GEN_MOVE(to);
+        }
+        if (board({ r, 7 }) == S::ROOK
+            && board({ r, 5 }) == Piece::NO_PIECE
+            && board({ r, 6 }) == Piece::NO_PIECE
+            && board.HasCastlingRights(CastlingSide::KING)
+            && !IsSquareAttacked(board, { r, 4 }, S::THEM)
+            && !IsSquareAttacked(board, { r, 5 }, S::THEM)
+            && !IsSquareAttacked(board, { r, 6 }, S::THEM)) {
+            Square to = { r, 6 };
+            GEN_MOVE(to);
+        }
+    }
+}
+
+template<Color Us>
+void GeneratePieceMoves(const Board& board, MoveList& moves, Square square, bool generateCastling) {
+    using S = Side<Us>;
+    switch (board(square)) {
+    case S::PAWN:
+        GeneratePawnMoves<Us>(board, moves, square);
+        break;
+    case S::ROOK:
+        GenerateSliderMoves<Us>(board, moves, square, rookDirections);
+        break;
+    case S::KNIGHT:
+        GenerateKnightMoves<Us>(board, moves, square);
+        break;
+    case S::BISHOP:
+        GenerateSliderMoves<Us>(board, moves, square, bishopDirections);
+        break;
+    case S::QUEEN:
+        GenerateSliderMoves<Us>(board, moves, square, bishopDirections);
+        GenerateSliderMoves<Us>(board, moves, square, rookDirections);
+        break;
+    case S::KING:
+        GenerateKingMoves<Us>(board, moves, square, generateCastling);
+        break;
+    default:
+        break;
+    }
+}
+
+void GeneratePieceMoves(const Board& board, MoveList& moves, Square square, bool generateCastling) {
+    if (board.GetTurn() == Color::WHITE) GeneratePieceMoves<Color::WHITE>(board, moves, square, generateCastling);
+    else GeneratePieceMoves<Color::BLACK>(board, moves, square, generateCastling);
+}
+
+template<Color Us>
+void GenerateMoves(const Board& board, MoveList& moves, bool generateCastling) {
+    for (int8_t r = 7; r >= 0; r--) {
+        for (int8_t f = 0; f < 8; f++) {
+            GeneratePieceMoves<Us>(board, moves, Square{ r, f }, generateCastling);
+        }
+    }
+}
+
+// The side to move is dispatched once, the generators of the pieces know it at compile time
+void GenerateMoves(const Board& board, MoveList& moves, bool generateCastling) {
+    if (board.GetTurn() == Color::WHITE) GenerateMoves<Color::WHITE>(board, moves, generateCastling);
+    else GenerateMoves<Color::BLACK>(board, moves, generateCastling);
+}
+
+template<Color Attacker>
+auto IsSquareAttacked(const Board& board, Square square) -> bool {
+    using S = Side<Attacker>;
+    // Pawns capture forward, so an attacking pawn stands one rank behind the square
+    for (int8_t file : { -1, 1 }) {
+        auto from = square.Add(-S::FORWARD, file);
+        if (from.IsValid() && board(from) == S::PAWN) return true;
+    }
+
+    for (int i = 0; i < 8; i++) {
+        auto from = square.Add(knightMoves[i]);
+        if (from.IsValid() && board(from) == S::KNIGHT) return true;
+        from = square.Add(kingDirections[i]);
+        if (from.IsValid() && board(from) == S::KING) return true;
+    }
+
+    auto IsSliderAttack = [&](const Direction* directions, Piece slider) {
+        for (int i = 0; i < 4; i++) {
+            auto from = square.Add(directions[i]);
+            while (from.IsValid() && board.IsEmpty(from)) {
+                from = from.Add(directions[i]);
+            }
+            if (from.IsValid() && (board(from) == slider || board(from) == S::QUEEN)) return true;
+        }
+        return false;
+    };
+    return IsSliderAttack(bishopDirections, S::BISHOP) || IsSliderAttack(rookDirections, S::ROOK);
+}
+
+auto IsSquareAttacked(const Board& board, Square square, Color attacker) -> bool {
+    return attacker == Color::WHITE ? IsSquareAttacked<Color::WHITE>(board, square) : IsSquareAttacked<Color::BLACK>(board, square);
+}
+
+auto FindKing(const Board& board, Color color, Square& square) -> bool {
+    auto king = color == Color::WHITE ? Piece::WHITE_KING : Piece::BLACK_KING;
+    for (int8_t r = 0; r < 8; r++) {
+        for (int8_t f = 0; f < 8; f++) {
+            if (board({ r, f }) == king) {
+                square = { r, f };
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+auto IsInCheck(Board& board) -> bool {
+    Square king;
+    return FindKing(board, board.GetTurn(), king) && IsSquareAttacked(board, king, InvertColor(board.GetTurn()));
+}
+
+auto CanCaptureKing(const Board& board) -> bool {
+    Square king;
+    auto opponent = InvertColor(board.GetTurn());
+    return FindKing(board, opponent, king) && IsSquareAttacked(board, king, board.GetTurn());
+}
+
+// Moves the pieces on a copy of the board, which is all the attack test needs, instead of doing the move on theBoard
+auto LeavesKingInCheck(const Board& board, const Move& move, Square king) -> bool {
+    Board after = board;
+    auto piece = after(move.from);
+    if ((piece == Piece::WHITE_PAWN || piece == Piece::BLACK_PAWN) && move.from.file != move.to.file && after.IsEmpty(move.to)) {
+        after({ move.from.rank, move.to.file }) = Piece::NO_PIECE;
+    }
+    if (piece == Piece::WHITE_KING || piece == Piece::BLACK_KING) {
+        king = move.to;
+        // The rook of a castling move blocks the rank
+        if (move.to.file - move.from.file == 2) std::swap(after({ move.from.rank, 7 }), after({ move.from.rank, 5 }));
+        if (move.from.file - move.to.file == 2) std::swap(after({ move.from.rank, 0 }), after({ move.from.rank, 3 }));
+    }
+    after(move.to) = piece;
+    after(move.from) = Piece::NO_PIECE;
+    return IsSquareAttacked(after, king, InvertColor(board.GetTurn()));
+}
+
+auto IsMoveValid(const Board& board, const Move& move) -> bool {
+    if (!move.from.IsValid() || !board.IsCurrentPlayer(move.from)) return false;
+    // Only the moves of the moving piece are needed
+    MoveList moves;
+    GeneratePieceMoves(board, moves, move.from, true);
+    bool found = false;
+    for (const Move& m : moves) {
+        if (m == move) found = true;
+    }
+    if (!found) return false;
+    // We cannot set ourselves in check
+    Square king;
+    return !FindKing(board, board.GetTurn(), king) || !LeavesKingInCheck(board, move, king);
+}
+
+namespace {
+    struct LegalMoveCacheEntry {
+        uint64_t hash = 0;
+        MoveList moves;
+    };
+
+    // Direct mapped on the hash, UI clients ask for the same few positions over and over
+    constexpr size_t LEGAL_MOVE_CACHE_SIZE = 256;
+    thread_local std::array<LegalMoveCacheEntry, LEGAL_MOVE_CACHE_SIZE> legalMoveCache;
+}
+
+void GenerateLegalMoves(const Board& board, MoveList& moves) {
+    auto& entry = legalMoveCache[board.GetHash() % LEGAL_MOVE_CACHE_SIZE];
+    if (entry.hash == board.GetHash()) {
+        moves = entry.moves;
+        return;
+    }
+
+    MoveList pseudoLegalMoves;
+    GenerateMoves(board, pseudoLegalMoves);
+    Square king;
+    auto hasKing = FindKing(board, board.GetTurn(), king);
+    moves = {};
+    for (auto& move : pseudoLegalMoves) {
+        if (!hasKing || !LeavesKingInCheck(board, move, king)) moves.AddMove(move);
+    }
+    entry.hash = board.GetHash();
+    entry.moves = moves;
+}
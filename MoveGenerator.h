@@ -1,9 +1,16 @@
-#pragma once
-
-#include "Board.h"
-#include "Move.h"
-#include "MoveList.h"
-
-void GenerateMoves(const Board& board, MoveList& moves, bool generateCastling = true);
-auto IsInCheck(Board& board) -> bool;
-auto IsMoveValid(const Board& board, const Move& move) -> bool;
\ No newline at end of file
+#pragma once
+
+#include "Board.h"
+#include "Move.h"
+#include "MoveList.h"
+
+void GenerateMoves(const Board& board, MoveList& moves, bool generateCastling = true);
+// Whether a piece of the attacker could capture on the square, regardless of whose turn it is
+auto IsSquareAttacked(const Board& board, Square square, Color attacker) -> bool;
+auto IsInCheck(Board& board) -> bool;
+// Whether the side to move can capture the king of the other side, which means the last move was illegal
+auto CanCaptureKing(const Board& board) -> bool;
+// Pseudo-legal move that does not leave the king of the mover in check
+auto IsMoveValid(const Board& board, const Move& move) -> bool;
+// All legal moves of the board, in the order of GenerateMoves. Cached per thread by the hash of the board.
+void GenerateLegalMoves(const Board& board, MoveList& moves);
\ No newline at end of file
@@ -0,0 +1,389 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "Board.h"
+#include "MappedFile.h"
+#include "MoveGenerator.h"
+#include "PgnBook.h"
+
+namespace {
+    constexpr int NUM_SHARDS = 64;
+    // Chunks are extended to the start of the next game, so every chunk holds whole games
+    constexpr size_t CHUNK_SIZE = 4 << 20;
+
+    enum class Outcome : uint8_t {
+        LOSS,
+        DRAW,
+        WIN,
+        UNKNOWN
+    };
+
+    struct MoveStats {
+        Move move;
+        uint32_t games = 0;
+        uint32_t wins = 0;
+        uint32_t draws = 0;
+        uint32_t losses = 0;
+    };
+
+    struct Shard {
+        std::mutex mutex;
+        std::unordered_map<uint64_t, std::vector<MoveStats>> positions;
+    };
+
+    struct PlayedMove {
+        uint64_t hash;
+        Move move;
+        Outcome outcome;
+    };
+
+    struct Counters {
+        std::atomic<uint64_t> games = 0;
+        std::atomic<uint64_t> skippedGames = 0;
+        std::atomic<uint64_t> invalidGames = 0;
+    };
+
+    auto IsSpace(char c) -> bool {
+        return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+    }
+
+    auto IsDigit(char c) -> bool {
+        return c >= '0' && c <= '9';
+    }
+
+    auto ToFile(char c) -> int8_t {
+        return c >= 'a' && c <= 'h' ? c - 'a' : -1;
+    }
+
+    auto ToRank(char c) -> int8_t {
+        return c >= '1' && c <= '8' ? c - '1' : -1;
+    }
+
+    auto GetPiece(char type, Color color) -> Piece {
+        Piece piece;
+        switch (type) {
+        case 'N': piece = Piece::WHITE_KNIGHT; break;
+        case 'B': piece = Piece::WHITE_BISHOP; break;
+        case 'R': piece = Piece::WHITE_ROOK; break;
+        case 'Q': piece = Piece::WHITE_QUEEN; break;
+        case 'K': piece = Piece::WHITE_KING; break;
+        default: piece = Piece::WHITE_PAWN; break;
+        }
+        return color == Color::WHITE ? piece : InvertPiece(piece);
+    }
+
+    // Value of a tag line like [Result "1-0"], empty when the line is not that tag
+    auto GetTagValue(std::string_view line, std::string_view name) -> std::string_view {
+        if (line.size() < name.size() + 2 || line.substr(1, name.size()) != name || line[name.size() + 1] != ' ') return {};
+        auto start = line.find('"');
+        auto end = line.rfind('"');
+        if (start == std::string_view::npos || end <= start) return {};
+        return line.substr(start + 1, end - start - 1);
+    }
+
+    // Offset of the next tag section at or after the given offset, or the size of the text
+    auto FindNextGame(std::string_view text, size_t offset) -> size_t {
+        while (true) {
+            auto found = text.find("\n[", offset);
+            if (found == std::string_view::npos || found + 2 >= text.size()) return text.size();
+            // Skips clock annotations like [%clk 0:01:00] that start a line inside a comment
+            auto c = text[found + 2];
+            if ((c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z')) return found + 1;
+            offset = found + 1;
+        }
+    }
+
+    // Replays the movetext of one game on theBoard, returns false when a move could not be parsed
+    auto ReplayGame(std::string_view movetext, int maxPly, std::vector<PlayedMove>& played) -> bool {
+        size_t i = 0;
+        int ply = 0;
+        while (i < movetext.size() && ply < maxPly) {
+            auto c = movetext[i];
+            if (IsSpace(c)) {
+                i++;
+            }
+            else if (c == '{') {
+                auto end = movetext.find('}', i);
+                i = end == std::string_view::npos ? movetext.size() : end + 1;
+            }
+            else if (c == ';') {
+                auto end = movetext.find('\n', i);
+                i = end == std::string_view::npos ? movetext.size() : end + 1;
+            }
+            else if (c == '(') {
+                // Variations can be nested
+                int depth = 0;
+                for (; i < movetext.size(); i++) {
+                    if (movetext[i] == '(') depth++;
+                    else if (movetext[i] == ')' && --depth == 0) break;
+                }
+                i++;
+            }
+            else if (c == '$') {
+                i++;
+                while (i < movetext.size() && IsDigit(movetext[i])) i++;
+            }
+            else if (c == '*') {
+                return true;
+            }
+            else {
+                auto start = i;
+                while (i < movetext.size() && !IsSpace(movetext[i]) && movetext[i] != '{' && movetext[i] != '(' && movetext[i] != ';') i++;
+                auto token = movetext.substr(start, i - start);
+
+                if (token == "1-0" || token == "0-1" || token == "1/2-1/2") return true;
+                if (IsDigit(token[0]) && !token.starts_with("0-0")) {
+                    // Move number like 12. or 12..., possibly directly followed by the move
+                    auto dots = token.find_first_not_of("0123456789");
+                    if (dots == std::string_view::npos || token[dots] != '.') return false;
+                    token = token.substr(dots);
+                    while (!token.empty() && token[0] == '.') token.remove_prefix(1);
+                    if (token.empty()) continue;
+                }
+
+                auto move = ParseSANMove(token);
+                if (move == INVALID_MOVE) return false;
+                played.push_back({ theBoard.GetHash(), move, Outcome::UNKNOWN });
+                DoMove(move);
+                theBoard.SwitchTurn();
+                ply++;
+            }
+        }
+        return true;
+    }
+
+    void ParseGames(std::string_view text, int maxPly, std::vector<PlayedMove>& played, Counters& counters) {
+        size_t pos = 0;
+        while (pos < text.size()) {
+            auto result = std::string_view{};
+            auto fen = std::string_view{};
+            bool standard = true;
+
+            // Tag pairs
+            while (pos < text.size() && (IsSpace(text[pos]) || text[pos] == '[')) {
+                if (text[pos] != '[') {
+                    pos++;
+                    continue;
+                }
+                auto end = text.find('\n', pos);
+                if (end == std::string_view::npos) end = text.size();
+                auto line = text.substr(pos, end - pos);
+                if (auto value = GetTagValue(line, "Result"); !value.empty()) result = value;
+                if (auto value = GetTagValue(line, "FEN"); !value.empty()) fen = value;
+                if (auto value = GetTagValue(line, "Variant"); !value.empty() && value != "Standard") standard = false;
+                pos = end;
+            }
+
+            auto end = FindNextGame(text, pos);
+            auto movetext = text.substr(pos, end - pos);
+            pos = end;
+            if (movetext.empty() && result.empty()) continue;
+
+            auto whiteOutcome = result == "1-0" ? Outcome::WIN
+                : result == "0-1" ? Outcome::LOSS
+                : result == "1/2-1/2" ? Outcome::DRAW
+                : Outcome::UNKNOWN;
+
+            counters.games++;
+            // An unfinished game, like *, says nothing about the moves played in it
+            if (!standard || whiteOutcome == Outcome::UNKNOWN) {
+                counters.skippedGames++;
+                continue;
+            }
+
+            if (fen.empty()) SetDefaultBoard(theBoard);
+            else ParseFENBoard(theBoard, std::string(fen));
+            ClearHistory();
+
+            auto firstMove = played.size();
+            auto mover = theBoard.GetTurn();
+            if (!ReplayGame(movetext, maxPly, played)) {
+                counters.invalidGames++;
+            }
+
+            auto blackOutcome = whiteOutcome == Outcome::WIN ? Outcome::LOSS
+                : whiteOutcome == Outcome::LOSS ? Outcome::WIN
+                : whiteOutcome;
+            for (auto i = firstMove; i < played.size(); i++) {
+                played[i].outcome = mover == Color::WHITE ? whiteOutcome : blackOutcome;
+                mover = InvertColor(mover);
+            }
+        }
+    }
+
+    auto GetShardIndex(uint64_t hash) -> int {
+        // The low bits already select the bucket inside the shard
+        return static_cast<int>(hash >> 58) % NUM_SHARDS;
+    }
+
+    void AddToShards(const std::vector<PlayedMove>& played, std::vector<Shard>& shards) {
+        std::vector<std::vector<const PlayedMove*>> byShard(NUM_SHARDS);
+        for (auto& move : played) {
+            byShard[GetShardIndex(move.hash)].push_back(&move);
+        }
+
+        for (int i = 0; i < NUM_SHARDS; i++) {
+            if (byShard[i].empty()) continue;
+            std::lock_guard lock(shards[i].mutex);
+            for (auto move : byShard[i]) {
+                auto& moves = shards[i].positions[move->hash];
+                auto it = std::find_if(moves.begin(), moves.end(), [&](const MoveStats& stats) { return stats.move == move->move; });
+                if (it == moves.end()) {
+                    moves.push_back({ move->move });
+                    it = moves.end() - 1;
+                }
+                it->games++;
+                if (move->outcome == Outcome::WIN) it->wins++;
+                else if (move->outcome == Outcome::LOSS) it->losses++;
+                else it->draws++;
+            }
+        }
+    }
+}
+
+auto ParseSANMove(std::string_view san) -> Move {
+    while (!san.empty() && (san.back() == '+' || san.back() == '#' || san.back() == '!' || san.back() == '?')) {
+        san.remove_suffix(1);
+    }
+
+    auto turn = theBoard.GetTurn();
+    int8_t homeRank = turn == Color::WHITE ? 0 : 7;
+    auto pieceType = 'P';
+    int8_t fromFile = -1;
+    int8_t fromRank = -1;
+    Square to;
+
+    if (san == "O-O" || san == "0-0") {
+        pieceType = 'K';
+        to = { homeRank, 6 };
+    }
+    else if (san == "O-O-O" || san == "0-0-0") {
+        pieceType = 'K';
+        to = { homeRank, 2 };
+    }
+    else {
+        // Promotions are always to a queen in this engine, an underpromotion cannot be replayed
+        auto promotion = san.find('=');
+        if (promotion != std::string_view::npos) {
+            if (san.substr(promotion + 1) != "Q") return INVALID_MOVE;
+            san = san.substr(0, promotion);
+        }
+        else if (san.size() >= 3 && ToRank(san[san.size() - 2]) != -1 && std::string_view("NBRQ").find(san.back()) != std::string_view::npos) {
+            if (san.back() != 'Q') return INVALID_MOVE;
+            san.remove_suffix(1);
+        }
+
+        if (!san.empty() && std::string_view("NBRQK").find(san[0]) != std::string_view::npos) {
+            pieceType = san[0];
+            san.remove_prefix(1);
+        }
+        if (san.size() < 2) return INVALID_MOVE;
+        to = { ToRank(san[san.size() - 1]), ToFile(san[san.size() - 2]) };
+        if (!to.IsValid()) return INVALID_MOVE;
+        san.remove_suffix(2);
+
+        for (auto c : san) {
+            if (c == 'x' || c == ':') continue;
+            else if (ToFile(c) != -1) fromFile = ToFile(c);
+            else if (ToRank(c) != -1) fromRank = ToRank(c);
+            else return INVALID_MOVE;
+        }
+    }
+
+    auto piece = GetPiece(pieceType, turn);
+    MoveList moves;
+    GenerateMoves(theBoard, moves);
+    MoveList candidates;
+    for (auto move : moves) {
+        if (!(move.to == to) || theBoard(move.from) != piece) continue;
+        if (fromFile != -1 && move.from.file != fromFile) continue;
+        if (fromRank != -1 && move.from.rank != fromRank) continue;
+        candidates.AddMove(move);
+    }
+    if (candidates.GetNumMoves() == 1) return candidates.GetMove(0);
+
+    // Notation leaves out disambiguation when the other piece is pinned
+    auto found = INVALID_MOVE;
+    int numFound = 0;
+    for (auto move : candidates) {
+        DoMove(move);
+        auto legal = !IsInCheck(theBoard);
+        UndoMove();
+        if (legal) {
+            found = move;
+            numFound++;
+        }
+    }
+    return numFound == 1 ? found : INVALID_MOVE;
+}
+
+auto BuildPgnBook(const PgnBookOptions& options) -> bool {
+    MappedFile pgn;
+    if (!pgn.Open(options.pgnFile)) {
+        std::cerr << "Cannot open " << options.pgnFile << "\n";
+        return false;
+    }
+    std::string_view text(reinterpret_cast<const char*>(pgn.GetData()), pgn.GetSize());
+
+    auto startTime = std::chrono::steady_clock::now();
+
+    std::vector<size_t> chunkStarts = { 0 };
+    while (chunkStarts.back() < text.size()) {
+        auto next = chunkStarts.back() + CHUNK_SIZE;
+        chunkStarts.push_back(next >= text.size() ? text.size() : FindNextGame(text, next));
+    }
+    auto numChunks = static_cast<int>(chunkStarts.size()) - 1;
+
+    std::vector<Shard> shards(NUM_SHARDS);
+    Counters counters;
+    std::atomic<int> nextChunk = 0;
+
+    auto numThreads = options.threads > 0 ? options.threads : std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    std::vector<std::thread> workers;
+    for (int i = 0; i < numThreads; i++) {
+        workers.emplace_back([&]() {
+            std::vector<PlayedMove> played;
+            while (true) {
+                auto chunk = nextChunk++;
+                if (chunk >= numChunks) return;
+                played.clear();
+                ParseGames(text.substr(chunkStarts[chunk], chunkStarts[chunk + 1] - chunkStarts[chunk]), options.maxPly, played, counters);
+                AddToShards(played, shards);
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    std::vector<BookMove> bookMoves;
+    uint64_t numPositions = 0;
+    for (auto& shard : shards) {
+        numPositions += shard.positions.size();
+        for (auto& [hash, moves] : shard.positions) {
+            for (auto& stats : moves) {
+                auto weight = 2 * stats.wins + stats.draws;
+                if (stats.games < static_cast<uint32_t>(options.minGames) || weight == 0) continue;
+                bookMoves.push_back({ hash, stats.move, weight });
+            }
+        }
+    }
+
+    auto written = WriteBook(options.bookFile, bookMoves);
+
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime).count();
+    std::cout << "Games           : " << counters.games.load() << "\n";
+    std::cout << "Skipped games   : " << counters.skippedGames.load() << "\n";
+    std::cout << "Invalid games   : " << counters.invalidGames.load() << "\n";
+    std::cout << "Positions       : " << numPositions << "\n";
+    std::cout << "Book moves      : " << bookMoves.size() << "\n";
+    std::cout << "Time (ms)       : " << ms << "\n";
+    std::cout << "MB/second       : " << text.size() / 1000.0 / std::max<int64_t>(ms, 1) << std::endl;
+    return written;
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+#include "Book.h"
+#include "Move.h"
+
+constexpr int DEFAULT_PGN_BOOK_PLY = 24;
+constexpr int DEFAULT_PGN_BOOK_MIN_GAMES = 2;
+
+struct PgnBookOptions {
+    std::string pgnFile;
+    std::string bookFile = BOOK_FILE;
+    // Moves after this ply are not added to the book
+    int maxPly = DEFAULT_PGN_BOOK_PLY;
+    // Zero uses all cores
+    int threads = 0;
+    // Moves played in fewer games are left out
+    int minGames = DEFAULT_PGN_BOOK_MIN_GAMES;
+};
+
+// Parses a move in standard algebraic notation for the position of theBoard, INVALID_MOVE when it is not a legal move
+// or promotes to anything but a queen
+auto ParseSANMove(std::string_view san) -> Move;
+
+// Replays the games of a PGN file in parallel and writes a binary book of the positions up to the maximum ply.
+// Moves are weighted by their results for the side that played them: two for a win, one for a draw.
+// Games without a result are skipped.
+auto BuildPgnBook(const PgnBookOptions& options) -> bool;
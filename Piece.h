@@ -1,67 +1,97 @@
-#pragma once
-
-#include <iostream>
-#include <numeric>
-
-enum class Piece : uint8_t {
-    NO_PIECE,
-    WHITE_PAWN,
-    WHITE_ROOK,
-    WHITE_KNIGHT,
-    WHITE_BISHOP,
-    WHITE_QUEEN,
-    WHITE_KING,
-    BLACK_PAWN,
-    BLACK_ROOK,
-    BLACK_KNIGHT,
-    BLACK_BISHOP,
-    BLACK_QUEEN,
-    BLACK_KING,
-};
-
-Piece InvertPiece(Piece piece);
-
-inline std::ostream& operator<<(std::ostream& o, Piece piece) {
-    switch (piece) {
-    case Piece::NO_PIECE:
-        o << ".";
-        break;
-    case Piece::WHITE_PAWN:
-        o << "p";
-        break;
-    case Piece::WHITE_ROOK:
-        o << "r";
-        break;
-    case Piece::WHITE_KNIGHT:
-        o << "n";
-        break;
-    case Piece::WHITE_BISHOP:
-        o << "b";
-        break;
-    case Piece::WHITE_QUEEN:
-        o << "q";
-        break;
-    case Piece::WHITE_KING:
-        o << "k";
-        break;
-    case Piece::BLACK_PAWN:
-        o << "P";
-        break;
-    case Piece::BLACK_ROOK:
-        o << "R";
-        break;
-    case Piece::BLACK_KNIGHT:
-        o << "N";
-        break;
-    case Piece::BLACK_BISHOP:
-        o << "B";
-        break;
-    case Piece::BLACK_QUEEN:
-        o << "Q";
-        break;
-    case Piece::BLACK_KING:
-        o << "K";
-        break;
-    }
-    return o;
+#pragma once
+
+#include <cstdint>
+#include <iostream>
+
+// The low three bits hold the type of the piece, BLACK_PIECE_BIT is set for black pieces.
+// White pieces have the value of their type.
+enum class Piece : uint8_t {
+    NO_PIECE,
+    WHITE_PAWN,
+    WHITE_ROOK,
+    WHITE_KNIGHT,
+    WHITE_BISHOP,
+    WHITE_QUEEN,
+    WHITE_KING,
+    BLACK_PAWN = 9,
+    BLACK_ROOK,
+    BLACK_KNIGHT,
+    BLACK_BISHOP,
+    BLACK_QUEEN,
+    BLACK_KING,
+};
+
+enum class PieceType : uint8_t {
+    NONE,
+    PAWN,
+    ROOK,
+    KNIGHT,
+    BISHOP,
+    QUEEN,
+    KING,
+};
+
+constexpr int NUM_PIECE_TYPES = 7;
+// Tables indexed by piece, including the unused values between the colors
+constexpr int NUM_PIECE_VALUES = 16;
+constexpr uint8_t PIECE_TYPE_MASK = 7;
+constexpr uint8_t BLACK_PIECE_BIT = 8;
+
+constexpr auto GetPieceType(Piece piece) -> PieceType {
+    return static_cast<PieceType>(static_cast<uint8_t>(piece) & PIECE_TYPE_MASK);
+}
+
+constexpr auto IsBlackPiece(Piece piece) -> bool {
+    return (static_cast<uint8_t>(piece) & BLACK_PIECE_BIT) != 0;
+}
+
+// Flips the color bit of every piece, adding seven to the type only carries into that bit when there is a piece
+constexpr auto InvertPiece(Piece piece) -> Piece {
+    auto value = static_cast<uint8_t>(piece);
+    return static_cast<Piece>(value ^ (((value & PIECE_TYPE_MASK) + 7) & BLACK_PIECE_BIT));
+}
+
+inline std::ostream& operator<<(std::ostream& o, Piece piece) {
+    switch (piece) {
+    case Piece::NO_PIECE:
+        o << ".";
+        break;
+    case Piece::WHITE_PAWN:
+        o << "p";
+        break;
+    case Piece::WHITE_ROOK:
+        o << "r";
+        break;
+    case Piece::WHITE_KNIGHT:
+        o << "n";
+        break;
+    case Piece::WHITE_BISHOP:
+        o << "b";
+        break;
+    case Piece::WHITE_QUEEN:
+        o << "q";
+        break;
+    case Piece::WHITE_KING:
+        o << "k";
+        break;
+    case Piece::BLACK_PAWN:
+        o << "P";
+        break;
+    case Piece::BLACK_ROOK:
+        o << "R";
+        break;
+    case Piece::BLACK_KNIGHT:
+        o << "N";
+        break;
+    case Piece::BLACK_BISHOP:
+        o << "B";
+        break;
+    case Piece::BLACK_QUEEN:
+        o << "Q";
+        break;
+    case Piece::BLACK_KING:
+        o << "K";
+        break;
+    }
+    return o;
 }
\ No newline at end of file
@@ -0,0 +1,197 @@
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <csignal>
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include <chrono>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include "Process.h"
+
+namespace {
+    // Time a process gets to exit after its input is closed
+    constexpr auto EXIT_TIMEOUT = std::chrono::milliseconds(2000);
+}
+
+auto Process::ReadLine(std::string& line) -> bool {
+    while (true) {
+        auto end = buffer.find('\n');
+        if (end != std::string::npos) {
+            line = buffer.substr(0, end);
+            buffer.erase(0, end + 1);
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            return true;
+        }
+        char data[4096];
+        auto read = Read(data, sizeof(data));
+        if (read <= 0) return false;
+        buffer.append(data, static_cast<size_t>(read));
+    }
+}
+
+#ifdef _WIN32
+
+auto Process::Start(const std::string& commandLine) -> bool {
+    Stop();
+    SECURITY_ATTRIBUTES attributes = { sizeof(SECURITY_ATTRIBUTES), nullptr, TRUE };
+    HANDLE childInput, childOutput, input, output;
+    if (!CreatePipe(&childInput, &input, &attributes, 0)) return false;
+    if (!CreatePipe(&output, &childOutput, &attributes, 0)) {
+        CloseHandle(childInput);
+        CloseHandle(input);
+        return false;
+    }
+    // Only the ends of the child are inherited
+    SetHandleInformation(input, HANDLE_FLAG_INHERIT, 0);
+    SetHandleInformation(output, HANDLE_FLAG_INHERIT, 0);
+
+    STARTUPINFOA startupInfo = {};
+    startupInfo.cb = sizeof(startupInfo);
+    startupInfo.dwFlags = STARTF_USESTDHANDLES;
+    startupInfo.hStdInput = childInput;
+    startupInfo.hStdOutput = childOutput;
+    startupInfo.hStdError = GetStdHandle(STD_ERROR_HANDLE);
+
+    PROCESS_INFORMATION processInfo = {};
+    std::vector<char> mutableCommandLine(commandLine.begin(), commandLine.end());
+    mutableCommandLine.push_back('\0');
+    auto created = CreateProcessA(nullptr, mutableCommandLine.data(), nullptr, nullptr, TRUE, 0, nullptr, nullptr, &startupInfo, &processInfo);
+    CloseHandle(childInput);
+    CloseHandle(childOutput);
+    if (!created) {
+        CloseHandle(input);
+        CloseHandle(output);
+        return false;
+    }
+    CloseHandle(processInfo.hThread);
+
+    processHandle = processInfo.hProcess;
+    inputHandle = input;
+    outputHandle = output;
+    running = true;
+    return true;
+}
+
+void Process::Stop() {
+    if (!running) return;
+    CloseHandle(inputHandle);
+    if (WaitForSingleObject(processHandle, static_cast<DWORD>(EXIT_TIMEOUT.count())) != WAIT_OBJECT_0) {
+        TerminateProcess(processHandle, 1);
+        WaitForSingleObject(processHandle, INFINITE);
+    }
+    CloseHandle(outputHandle);
+    CloseHandle(processHandle);
+    processHandle = inputHandle = outputHandle = nullptr;
+    buffer.clear();
+    running = false;
+}
+
+auto Process::WriteLine(const std::string& line) -> bool {
+    if (!running) return false;
+    auto data = line + "\n";
+    DWORD written;
+    return WriteFile(inputHandle, data.data(), static_cast<DWORD>(data.size()), &written, nullptr) && written == data.size();
+}
+
+auto Process::Read(char* data, size_t size) -> long long {
+    if (!running) return -1;
+    DWORD read;
+    if (!ReadFile(outputHandle, data, static_cast<DWORD>(size), &read, nullptr)) return -1;
+    return read;
+}
+
+#else
+
+auto Process::Start(const std::string& commandLine) -> bool {
+    Stop();
+    // Writing to an engine that died must fail instead of ending this process
+    std::signal(SIGPIPE, SIG_IGN);
+
+    std::vector<std::string> arguments;
+    std::istringstream is(commandLine);
+    for (std::string argument; is >> argument;) {
+        arguments.push_back(argument);
+    }
+    if (arguments.empty()) return false;
+    // Built before the fork, the child of a multithreaded process may only make async signal safe calls
+    std::vector<char*> argv;
+    for (auto& argument : arguments) argv.push_back(argument.data());
+    argv.push_back(nullptr);
+
+    // Close on exec, so engines started later do not inherit these ends and keep this engine's input open.
+    // dup2 clears the flag on the standard input and output of the child.
+    int toChild[2];
+    int fromChild[2];
+    if (pipe2(toChild, O_CLOEXEC) != 0) return false;
+    if (pipe2(fromChild, O_CLOEXEC) != 0) {
+        close(toChild[0]);
+        close(toChild[1]);
+        return false;
+    }
+
+    auto child = fork();
+    if (child < 0) {
+        for (auto fd : { toChild[0], toChild[1], fromChild[0], fromChild[1] }) close(fd);
+        return false;
+    }
+    if (child == 0) {
+        dup2(toChild[0], STDIN_FILENO);
+        dup2(fromChild[1], STDOUT_FILENO);
+        for (auto fd : { toChild[0], toChild[1], fromChild[0], fromChild[1] }) close(fd);
+        execvp(argv[0], argv.data());
+        _exit(127);
+    }
+
+    close(toChild[0]);
+    close(fromChild[1]);
+    pid = child;
+    inputFd = toChild[1];
+    outputFd = fromChild[0];
+    running = true;
+    return true;
+}
+
+void Process::Stop() {
+    if (!running) return;
+    close(inputFd);
+    auto deadline = std::chrono::steady_clock::now() + EXIT_TIMEOUT;
+    while (waitpid(pid, nullptr, WNOHANG) == 0) {
+        if (std::chrono::steady_clock::now() > deadline) {
+            kill(pid, SIGKILL);
+            waitpid(pid, nullptr, 0);
+            break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    close(outputFd);
+    pid = inputFd = outputFd = -1;
+    buffer.clear();
+    running = false;
+}
+
+auto Process::WriteLine(const std::string& line) -> bool {
+    if (!running) return false;
+    auto data = line + "\n";
+    size_t written = 0;
+    while (written < data.size()) {
+        auto result = write(inputFd, data.data() + written, data.size() - written);
+        if (result <= 0) return false;
+        written += static_cast<size_t>(result);
+    }
+    return true;
+}
+
+auto Process::Read(char* data, size_t size) -> long long {
+    if (!running) return -1;
+    return read(outputFd, data, size);
+}
+
+#endif
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <string>
+
+// Child process with its standard input and output connected to pipes, to talk to engines line by line
+class Process {
+public:
+    Process() = default;
+    Process(const Process&) = delete;
+    Process& operator=(const Process&) = delete;
+
+    ~Process() {
+        Stop();
+    }
+
+    // The command line is split on spaces, the first part is the executable
+    auto Start(const std::string& commandLine) -> bool;
+    // Closes the pipes and waits for the process, killing it when it does not exit by itself
+    void Stop();
+
+    auto IsRunning() const -> bool {
+        return running;
+    }
+
+    auto WriteLine(const std::string& line) -> bool;
+    // Blocks until a whole line is read, false when the process closed its output
+    auto ReadLine(std::string& line) -> bool;
+
+private:
+    auto Read(char* data, size_t size) -> long long;
+
+    bool running = false;
+    std::string buffer;
+#ifdef _WIN32
+    void* processHandle = nullptr;
+    void* inputHandle = nullptr;
+    void* outputHandle = nullptr;
+#else
+    int pid = -1;
+    int inputFd = -1;
+    int outputFd = -1;
+#endif
+};
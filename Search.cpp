@@ -1,338 +1,656 @@
-#include <iostream>
-#include <optional>
-#include <thread>
-
-#include "Book.h"
-#include "Evaluate.h"
-#include "MoveGenerator.h"
-#include "MoveOrder.h"
-#include "Search.h"
-#include "TranspositionTable.h"
-
-int numEvaluates;
-int numCacheHits;
-int numCacheMisses;
-int depthReached;
-
-int searchDepth = 8;
-int searchTime = 1;
-volatile bool searchRunning = false;
-auto bestMoveSoFar = INVALID_MOVE;
-std::optional<std::thread> ponderThread;
-
-auto QuiescenceSearch(int depth, int alpha, int beta) -> int {
-    auto entry = GetEntry(theBoard.GetHash());
-    auto hashMove = INVALID_MOVE;
-    if (entry->hash == theBoard.GetHash()) {
-        hashMove = entry->bestMove;
-        if (entry->depth >= depth) {
-            numCacheHits++;
-            if (entry->bound == Bound::EXACT) {
-                return entry->score;
-            }
-            if (entry->bound == Bound::LOWER_BOUND && entry->score >= beta) {
-                return beta;
-            }
-        }
-    }
-    else {
-        numCacheMisses++;
-    }
-
-    MoveList moves;
-    GenerateMoves(theBoard, moves);
-    std::array<int, 128> indices;
-    std::iota(indices.begin(), indices.begin() + moves.GetNumMoves(), 0);
-
-    OrderMoves(theBoard, moves, indices, hashMove, depth < MAX_KILLERS_DEPTH ? killers[depth] : killers[0]);
-
-    auto maxScore = EvaluateBoard(theBoard);
-    auto bestMove = INVALID_MOVE;
-    auto bound = Bound::UPPER_BOUND;
-
-    for (int i = 0; i < moves.GetNumMoves(); i++) {
-        auto index = indices[i];
-        auto move = moves.GetMove(index);
-        // Search no further if king was captured
-        if (theBoard(move.to) == Piece::WHITE_KING ||
-            theBoard(move.to) == Piece::BLACK_KING)
-            return MAX_SCORE;
-
-        if (theBoard.IsEmpty(move.to)) continue;
-
-        DoMove(move);
-        theBoard.SwitchTurn();
-        auto score = -QuiescenceSearch(depth - 1, -beta, -alpha);
-        theBoard.SwitchTurn();
-        UndoMove();
-
-        if (score > alpha) {
-            bound = Bound::EXACT;
-            alpha = score;
-        }
-        if (score >= beta) {
-            entry->depth = depth;
-            entry->hash = theBoard.GetHash();
-            entry->bound = Bound::LOWER_BOUND;
-            entry->bestMove = move;
-            entry->score = score;
-            return beta;
-        }
-        if (score > maxScore) {
-            maxScore = score;
-        }
-    }
-
-    entry->depth = depth;
-    entry->hash = theBoard.GetHash();
-    entry->bound = bound;
-    entry->bestMove = bestMove;
-    entry->score = maxScore;
-
-    return maxScore;
-}
-
-
-auto MinMax(int depth, int alpha, int beta) -> int {
-    if (depth <= 0) {
-        numEvaluates++;
-        return QuiescenceSearch(0, alpha, beta);
-        //return EvaluateBoard(theBoard);
-    }
-
-    auto entry = GetEntry(theBoard.GetHash());
-    auto hashMove = INVALID_MOVE;
-    if (entry->hash == theBoard.GetHash()) {
-        hashMove = entry->bestMove;
-        if (entry->depth >= depth) {
-            numCacheHits++;
-            if (entry->bound == Bound::EXACT) {
-                if (depth == searchDepth) {
-                    bestMoveSoFar = entry->bestMove;
-                }
-                return entry->score;
-            }
-            if (entry->bound == Bound::LOWER_BOUND && entry->score >= beta) {
-                return beta;
-            }
-        }
-    }
-    else {
-        numCacheMisses++;
-    }
-
-    MoveList moves;
-    GenerateMoves(theBoard, moves);
-    if (moves.GetNumMoves() == 0) {
-        return 0;
-    }
-
-    std::array<int, 128> indices;
-    std::iota(indices.begin(), indices.end(), 0);
-
-    OrderMoves(theBoard, moves, indices, hashMove, depth < MAX_KILLERS_DEPTH ? killers[depth] : killers[0]);
-
-    auto bestMove = INVALID_MOVE;
-    auto bound = Bound::UPPER_BOUND;
-
-    for (int i = 0; i < moves.GetNumMoves(); i++) {
-        auto index = indices[i];
-        auto move = moves.GetMove(index);
-        // Search no further if king was captured
-        if (theBoard(move.to) == Piece::WHITE_KING ||
-            theBoard(move.to) == Piece::BLACK_KING)
-            return MAX_SCORE;
-
-        // Reduce search for quiet moves
-        int reduction = 0;
-        if (i >= 3 && searchDepth - depth >= 3 && theBoard.IsEmpty(move.to)) {
-            reduction = 1;
-        }
-
-        DoMove(move);
-        theBoard.SwitchTurn();
-        auto score = -MinMax(depth - 1 - reduction, -beta, -alpha);
-        // If move is good, search for full depth
-        if (score > alpha && reduction > 0) {
-            score = -MinMax(depth - 1, -beta, -alpha);
-        }
-        theBoard.SwitchTurn();
-        UndoMove();
-
-        if (!searchRunning) {
-            // Search aborted, return value is garbage when search is aborted
-            return 0;
-        }
-
-        //Adjust score for number of moves
-        if (score > MAX_SCORE - 128) score--;
-
-        if (score >= beta) {
-            if (theBoard(move.to) == Piece::NO_PIECE && depth < MAX_KILLERS_DEPTH) {
-                killers[depth].Add(move);
-            }
-
-            entry->depth = depth;
-            entry->hash = theBoard.GetHash();
-            entry->bound = Bound::LOWER_BOUND;
-            entry->bestMove = move;
-            entry->score = score;
-            return beta;
-        }
-        if (score > alpha) {
-            bound = Bound::EXACT;
-            alpha = score;
-            bestMove = move;
-            if (depth == searchDepth) {
-                bestMoveSoFar = move;
-            }
-        }
-    }
-
-    if (alpha == -MAX_SCORE) {
-        // The enemy can take my king next turn
-        // If he can take it now, then we are in mate
-        theBoard.SwitchTurn();
-        auto s = -MinMax(1, -beta, -alpha);
-        theBoard.SwitchTurn();
-        if (s == -MAX_SCORE) {
-            return -MAX_SCORE;                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                               return -MAX_SCORE;
-        }
-        else {
-            // Otherwise it is stale mate
-            return 0;
-        }
-    }
-
-    entry->depth = depth;
-    entry->hash = theBoard.GetHash();
-    entry->bound = bound;
-    entry->bestMove = bestMove;
-    entry->score = alpha;
-
-    return alpha;
-}
-
-auto FindBestMove() -> Move {
-    numEvaluates = 0;
-    numCacheHits = 0;
-    numCacheMisses = 0;
-    MinMax(searchDepth, -1000000, 1000000);
-    auto entry = GetEntry(theBoard.GetHash());
-    assert(entry->hash == theBoard.GetHash());
-    return entry->bestMove;
-}
-
-auto SearchInThread() {
-    searchDepth = 1;
-    auto score = 0;
-    while (searchRunning) {
-        searchDepth++;
-
-        auto delta = 5 + abs(score) / 5;
-        auto alpha = score - delta;
-        auto beta = score + delta;
-
-        while (true) {
-            score = MinMax(searchDepth, alpha, beta);
-            if (score <= alpha) {
-                alpha -= delta;
-                delta += delta / 3;
-            }
-            else if (score >= beta) {
-                beta += delta;
-                delta += delta / 3;
-            }
-            else {
-                break;
-            }
-        }
-
-        //auto entry = GetEntry(theBoard.GetHash());
-        //std::cout << searchDepth << " " << entry->bestMove << " " << score << "\n";
-        
-    }
-    depthReached = searchDepth;
-}
-
-void Ponder() {
-    SearchInThread();
-}
-
-void StartPondering() {
-    if (ponderThread) return;
-    searchRunning = true;
-    ponderThread = std::thread { Ponder };
-}
-
-void StopPondering() {
-    if (!ponderThread) return;
-    searchRunning = false;
-    ponderThread->join();
-    ponderThread = {};
-}
-
-auto FindBestMoveInTime() -> Move {
-    auto bookMove = GetBookMove(theBoard);
-    if (bookMove.has_value()) return *bookMove;
-
-    //StopPondering();
-    numEvaluates = 0;
-    numCacheHits = 0;
-    numCacheMisses = 0;
-    depthReached = 1;
-    searchRunning = true;
-    std::thread t([&]() { SearchInThread(); });
-    std::this_thread::sleep_for(std::chrono::seconds(searchTime));
-    searchRunning = false;
-    t.join();
-    //StartPondering();
-    return bestMoveSoFar;
-}
-
-auto IsInMate() -> bool {
-    searchDepth = 4; // To prevent print
-    searchRunning = true;
-    auto score = MinMax(2, -1000000, 1000000);
-    searchRunning = false;
-    return score == -MAX_SCORE;
-}
-
-void Benchmark() {
-    ParseBoard(theBoard,
-        "RNBQKBNR"
-        "PPPPPPPP"
-        "........"
-        "........"
-        "........"
-        "........"
-        "pppppppp"
-        "rnbqkbnr"
-    );
-    auto startTime = std::chrono::high_resolution_clock::now();
-    searchDepth = 10;
-    searchRunning = true;
-
-    auto alpha = -100;
-    auto beta = 100;
-    auto delta = 100;
-    while (true) {
-        auto result = MinMax(searchDepth, alpha, beta);
-        if (result <= alpha) {
-            alpha -= delta;
-            delta += delta / 3;
-        }
-        else if (result >= beta) {
-            beta += delta;
-            delta = std::max(delta + delta / 3, result);
-        }
-        else {
-            break;
-        }
-    }
-
-    searchRunning = false;
-    auto endTime = std::chrono::high_resolution_clock::now();
-    auto ms = std::chrono::duration<double, std::milli>(endTime - startTime).count();
-    std::cout << "Time taken " << ms << " ms";
+#include <algorithm>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "Book.h"
+#include "Evaluate.h"
+#include "MoveGenerator.h"
+#include "MoveOrder.h"
+#include "Search.h"
+#include "SearchStats.h"
+#include "Tablebase.h"
+#include "TimeManager.h"
+#include "TranspositionTable.h"
+
+thread_local int depthReached;
+thread_local SearchSignals* searchSignals = nullptr;
+
+thread_local int searchDepth = 8;
+thread_local bool searchRunning = false;
+thread_local auto bestMoveSoFar = INVALID_MOVE;
+thread_local TimeManager timeManager;
+thread_local int selDepth;
+thread_local InfoCallback infoCallback;
+// Moves of the better lines, left out at the root while searching the next line of a multi PV search
+thread_local std::vector<Move> excludedRootMoves;
+thread_local int multiPV = 1;
+thread_local SearchResult lastResult;
+
+// Entries for ply 0 up to MAX_PLY, where the search stops deepening
+thread_local SearchStackEntry searchStack[MAX_PLY + 1];
+
+void CheckSignals() {
+    if (!searchSignals) return;
+    if (timeManager.IsPondering() && searchSignals->ponderHit) {
+        timeManager.PonderHit();
+    }
+    if (searchSignals->stop) {
+        searchRunning = false;
+    }
+}
+
+inline void CheckLimits(int ply) {
+    if (ply > selDepth) selDepth = ply;
+    // Checking the clock and the signals is relatively expensive, only do it once in a while
+    auto nodes = searchStats.GetTotalNodes();
+    if ((nodes & 1023) == 0) {
+        CheckSignals();
+        if (searchDepth > 2 && timeManager.IsHardLimitReached(nodes)) {
+            searchRunning = false;
+        }
+    }
+}
+
+// Mate scores are stored relative to the node instead of the root, so they stay valid at another ply
+inline auto ScoreToTT(int score, int ply) -> int {
+    if (score > MATE_THRESHOLD) return score + ply;
+    if (score < -MATE_THRESHOLD) return score - ply;
+    return score;
+}
+
+inline auto ScoreFromTT(int score, int ply) -> int {
+    if (score > MATE_THRESHOLD) return score - ply;
+    if (score < -MATE_THRESHOLD) return score + ply;
+    return score;
+}
+
+inline void UpdatePV(SearchStackEntry* ss, Move move) {
+    ss->pv[0] = move;
+    auto childLength = std::min((ss + 1)->pvLength, MAX_PLY - 1);
+    for (int i = 0; i < childLength; i++) {
+        ss->pv[i + 1] = (ss + 1)->pv[i];
+    }
+    ss->pvLength = childLength + 1;
+}
+
+void ResetSearchStack() {
+    for (int ply = 0; ply <= MAX_PLY; ply++) {
+        searchStack[ply] = {};
+        searchStack[ply].ply = ply;
+    }
+}
+
+namespace {
+    // Quiescence results are stored at this depth, below every full width search entry
+    constexpr int QUIESCENCE_DEPTH = 0;
+    // Room for the positional swing of a capture on top of the material it wins
+    constexpr int DELTA_MARGIN = 200;
+
+    // The larger of the middle and end game values of the evaluation, per piece type
+    constexpr int captureValues[NUM_PIECE_TYPES] = { 0, 94, 512, 337, 365, 1025, 0 };
+
+    auto GetCaptureValue(Piece piece) -> int {
+        return captureValues[static_cast<int>(GetPieceType(piece))];
+    }
+
+    // A deeper entry of the same position is worth more than a quiescence result
+    void StoreQuiescenceEntry(TtEntry* entry, Bound bound, Move bestMove, int score, int ply) {
+        if (entry->hash == theBoard.GetHash() && entry->depth > QUIESCENCE_DEPTH) return;
+        entry->depth = QUIESCENCE_DEPTH;
+        entry->hash = theBoard.GetHash();
+        entry->bound = bound;
+        entry->bestMove = bestMove;
+        entry->score = ScoreToTT(score, ply);
+    }
+
+    auto IsPromotion(const Board& board, const Move& move) -> bool {
+        return GetPieceType(board(move.from)) == PieceType::PAWN && (move.to.rank == 0 || move.to.rank == 7);
+    }
+}
+
+// Fail soft: the returned score may lie outside of the window. Depth counts down from zero, at depth zero
+// a side in check searches all its evasions instead of standing pat.
+auto QuiescenceSearch(SearchStackEntry* ss, int depth, int alpha, int beta) -> int {
+    auto ply = ss->ply;
+    searchStats.quiescenceNodes++;
+    CheckLimits(ply);
+
+    // The previous move left its king in check. Tested before standing pat, which would hide the illegal move.
+    if (CanCaptureKing(theBoard)) return MAX_SCORE;
+    if (ply >= MAX_PLY) return EvaluateBoard(theBoard);
+
+    auto entry = GetEntry(theBoard.GetHash());
+    auto hashMove = INVALID_MOVE;
+    searchStats.ttProbes++;
+    if (entry->hash == theBoard.GetHash()) {
+        searchStats.ttHits++;
+        hashMove = entry->bestMove;
+        auto score = ScoreFromTT(entry->score, ply);
+        if (entry->depth >= QUIESCENCE_DEPTH) {
+            if (entry->bound == Bound::EXACT
+                || (entry->bound == Bound::LOWER_BOUND && score >= beta)
+                || (entry->bound == Bound::UPPER_BOUND && score <= alpha)) {
+                searchStats.CountTTCutoff(entry->bound);
+                return score;
+            }
+        }
+    }
+
+    auto originalAlpha = alpha;
+    auto inCheck = depth == 0 && IsInCheck(theBoard);
+    auto bestScore = -MAX_SCORE + ply;
+    auto standPat = 0;
+    if (!inCheck) {
+        standPat = EvaluateBoard(theBoard);
+        ss->staticEval = standPat;
+        if (standPat >= beta) return standPat;
+        // Delta pruning, not even winning a queen brings the score back to alpha
+        if (standPat + GetCaptureValue(Piece::WHITE_QUEEN) + DELTA_MARGIN < alpha) return standPat;
+        alpha = std::max(alpha, standPat);
+        bestScore = standPat;
+    }
+
+    MoveList moves;
+    GenerateMoves(theBoard, moves);
+    std::array<int, 128> indices;
+    std::iota(indices.begin(), indices.begin() + moves.GetNumMoves(), 0);
+
+    OrderMoves(theBoard, moves, indices, hashMove, ss->killers);
+
+    auto bestMove = INVALID_MOVE;
+    auto legalMoves = 0;
+
+    for (int i = 0; i < moves.GetNumMoves(); i++) {
+        auto index = indices[i];
+        auto move = moves.GetMove(index);
+
+        if (!inCheck) {
+            if (theBoard.IsEmpty(move.to)) continue;
+            if (standPat + GetCaptureValue(theBoard(move.to)) + DELTA_MARGIN <= alpha && !IsPromotion(theBoard, move)) {
+                searchStats.deltaPrunes++;
+                continue;
+            }
+        }
+
+        ss->currentMove = move;
+        DoMove(move);
+        theBoard.SwitchTurn();
+        auto score = -QuiescenceSearch(ss + 1, depth - 1, -beta, -alpha);
+        theBoard.SwitchTurn();
+        UndoMove();
+
+        // Evasions that leave the king in check are answered by capturing it
+        if (score == -MAX_SCORE) continue;
+        legalMoves++;
+
+        if (score > bestScore) {
+            bestScore = score;
+            bestMove = move;
+        }
+        if (score >= beta) {
+            StoreQuiescenceEntry(entry, Bound::LOWER_BOUND, move, score, ply);
+            return score;
+        }
+        if (score > alpha) {
+            alpha = score;
+        }
+    }
+
+    // Without legal evasions bestScore is the mate score
+    if (inCheck && legalMoves == 0) return bestScore;
+
+    StoreQuiescenceEntry(entry, bestScore > originalAlpha ? Bound::EXACT : Bound::UPPER_BOUND, bestMove, bestScore, ply);
+    return bestScore;
+}
+
+
+// The root handles the root move bookkeeping, PV nodes collect the principal variation and only non-PV nodes,
+// searched with a zero window, take cutoffs from the table
+enum class NodeType {
+    ROOT,
+    PV,
+    NON_PV
+};
+
+template<NodeType Node>
+auto MinMax(SearchStackEntry* ss, int depth, int alpha, int beta) -> int {
+    constexpr bool isRoot = Node == NodeType::ROOT;
+    constexpr bool isPV = Node != NodeType::NON_PV;
+    auto ply = ss->ply;
+    if constexpr (isPV) ss->pvLength = 0;
+    if (depth <= 0 || ply >= MAX_PLY) {
+        return QuiescenceSearch(ss, 0, alpha, beta);
+    }
+
+    searchStats.nodes++;
+    CheckLimits(ply);
+
+    // The previous move left its king in check. Tested before the draw rules, the mate distance pruning,
+    // the tablebase and the table, each of which would return a normal score for the illegal move.
+    if (CanCaptureKing(theBoard)) return MAX_SCORE;
+
+    if constexpr (!isRoot) {
+        if (IsDrawByRule(ply)) {
+            return 0;
+        }
+
+        // No line can do better than mating on the next ply, or worse than being mated here
+        alpha = std::max(alpha, -MAX_SCORE + ply);
+        beta = std::min(beta, MAX_SCORE - ply - 1);
+        if (alpha >= beta) {
+            return alpha;
+        }
+
+        int tablebaseScore;
+        if (ProbeTablebase(theBoard, tablebaseScore)) {
+            searchStats.tablebaseHits++;
+            return ScoreFromTT(tablebaseScore, ply);
+        }
+    }
+
+    // The result of a search that leaves out moves must not end up in the table
+    auto excluding = ss->excludedMove != INVALID_MOVE;
+    if constexpr (isRoot) excluding = excluding || !excludedRootMoves.empty();
+    TtEntry excludedEntry;
+    auto entry = excluding ? &excludedEntry : GetEntry(theBoard.GetHash());
+    auto hashMove = INVALID_MOVE;
+    searchStats.ttProbes++;
+    if (entry->hash == theBoard.GetHash()) {
+        searchStats.ttHits++;
+        hashMove = entry->bestMove;
+        if constexpr (!isPV) {
+            auto score = ScoreFromTT(entry->score, ply);
+            if (entry->depth >= depth) {
+                if (entry->bound == Bound::EXACT) {
+                    searchStats.CountTTCutoff(Bound::EXACT);
+                    return score;
+                }
+                if (entry->bound == Bound::LOWER_BOUND && score >= beta) {
+                    searchStats.CountTTCutoff(Bound::LOWER_BOUND);
+                    return beta;
+                }
+            }
+        }
+    }
+
+    MoveList moves;
+    GenerateMoves(theBoard, moves);
+
+    std::array<int, 128> indices;
+    std::iota(indices.begin(), indices.end(), 0);
+
+    OrderMoves(theBoard, moves, indices, hashMove, ss->killers);
+
+    auto bestMove = INVALID_MOVE;
+    auto bound = Bound::UPPER_BOUND;
+    auto legalMoves = 0;
+
+    for (int i = 0; i < moves.GetNumMoves(); i++) {
+        auto index = indices[i];
+        auto move = moves.GetMove(index);
+        if (move == ss->excludedMove) continue;
+        if constexpr (isRoot) {
+            if (excluding && std::find(excludedRootMoves.begin(), excludedRootMoves.end(), move) != excludedRootMoves.end()) {
+                continue;
+            }
+        }
+
+        // Reduce search for quiet moves
+        int reduction = 0;
+        if (i >= 3 && searchDepth - depth >= 3 && theBoard.IsEmpty(move.to)) {
+            reduction = 1;
+        }
+
+        ss->currentMove = move;
+        DoMove(move);
+        theBoard.SwitchTurn();
+        int score;
+        if (isPV && legalMoves == 0) {
+            score = -MinMax<NodeType::PV>(ss + 1, depth - 1, -beta, -alpha);
+        }
+        else {
+            // Later moves only have to prove they are not better than alpha
+            score = -MinMax<NodeType::NON_PV>(ss + 1, depth - 1 - reduction, -alpha - 1, -alpha);
+            // If move is good, search for full depth
+            if (score > alpha && reduction > 0) {
+                searchStats.lmrResearches++;
+                score = -MinMax<NodeType::NON_PV>(ss + 1, depth - 1, -alpha - 1, -alpha);
+            }
+            if (isPV && score > alpha && score < beta) {
+                score = -MinMax<NodeType::PV>(ss + 1, depth - 1, -beta, -alpha);
+            }
+        }
+        theBoard.SwitchTurn();
+        UndoMove();
+
+        if (!searchRunning) {
+            // Search aborted, return value is garbage when search is aborted
+            return 0;
+        }
+
+        // Moves that leave the king in check are answered by capturing it
+        if (score == -MAX_SCORE) continue;
+        legalMoves++;
+
+        if (score >= beta) {
+            searchStats.CountBetaCutoff(i);
+            if (theBoard(move.to) == Piece::NO_PIECE) {
+                ss->killers.Add(move);
+            }
+
+            entry->depth = depth;
+            entry->hash = theBoard.GetHash();
+            entry->bound = Bound::LOWER_BOUND;
+            entry->bestMove = move;
+            entry->score = ScoreToTT(score, ply);
+            return beta;
+        }
+        if (score > alpha) {
+            bound = Bound::EXACT;
+            alpha = score;
+            bestMove = move;
+            if constexpr (isPV) UpdatePV(ss, move);
+            if constexpr (isRoot) {
+                if (!excluding) bestMoveSoFar = move;
+            }
+        }
+    }
+
+    if (legalMoves == 0) {
+        return IsInCheck(theBoard) ? -MAX_SCORE + ply : 0;
+    }
+
+    entry->depth = depth;
+    entry->hash = theBoard.GetHash();
+    entry->bound = bound;
+    entry->bestMove = bestMove;
+    entry->score = ScoreToTT(alpha, ply);
+
+    return alpha;
+}
+
+auto MinMax(SearchStackEntry* ss, int depth, int alpha, int beta) -> int {
+    return MinMax<NodeType::ROOT>(ss, depth, alpha, beta);
+}
+
+auto FindBestMove() -> Move {
+    RegisterSearchStats();
+    searchStats.Reset();
+    timeManager.Start({}, theBoard.GetTurn());
+    searchRunning = true;
+    ResetSearchStack();
+    MinMax(searchStack, searchDepth, -1000000, 1000000);
+    searchRunning = false;
+    auto entry = GetEntry(theBoard.GetHash());
+    assert(entry->hash == theBoard.GetHash());
+    return entry->bestMove;
+}
+
+auto FormatScore(int score) -> std::string {
+    if (score > MATE_THRESHOLD) {
+        return "mate " + std::to_string((MAX_SCORE - score + 1) / 2);
+    }
+    if (score < -MATE_THRESHOLD) {
+        return "mate " + std::to_string(-(MAX_SCORE + score) / 2);
+    }
+    return "cp " + std::to_string(score);
+}
+
+// Line of the root as collected by the search. Only the best move when no line was collected, like after an
+// aborted first iteration, and empty when there is no move at all.
+auto GetRootPV() -> std::vector<Move> {
+    if (searchStack[0].pvLength == 0) {
+        if (bestMoveSoFar == INVALID_MOVE) return {};
+        return { bestMoveSoFar };
+    }
+    return { searchStack[0].pv, searchStack[0].pv + searchStack[0].pvLength };
+}
+
+void SendInfo(int score, Bound bound, const std::vector<Move>& pv, int line = 0) {
+    if (!infoCallback) return;
+
+    auto elapsed = timeManager.GetElapsed();
+    std::string info = "info depth " + std::to_string(searchDepth);
+    info += " seldepth " + std::to_string(selDepth);
+    if (multiPV > 1) info += " multipv " + std::to_string(line + 1);
+    info += " score " + FormatScore(score);
+    if (bound == Bound::LOWER_BOUND) info += " lowerbound";
+    if (bound == Bound::UPPER_BOUND) info += " upperbound";
+    auto nodes = searchStats.GetTotalNodes();
+    info += " nodes " + std::to_string(nodes);
+    info += " nps " + std::to_string(nodes * 1000 / std::max<int64_t>(elapsed, 1));
+    info += " hashfull " + std::to_string(GetHashFull());
+    if (searchStats.tablebaseHits > 0) info += " tbhits " + std::to_string(searchStats.tablebaseHits);
+    info += " time " + std::to_string(elapsed);
+    info += " pv";
+    for (auto move : pv) {
+        info += " " + MoveToUCI(move);
+    }
+    infoCallback(info);
+}
+
+auto CountLegalRootMoves() -> int {
+    MoveList moves;
+    GenerateLegalMoves(theBoard, moves);
+    return moves.GetNumMoves();
+}
+
+// Searches the root with an aspiration window around the score of the previous iteration
+auto SearchRoot(int score, int line) -> int {
+    auto delta = 5 + abs(score) / 5;
+    auto alpha = score - delta;
+    auto beta = score + delta;
+
+    while (true) {
+        score = MinMax(searchStack, searchDepth, alpha, beta);
+        if (!searchRunning) return score;
+
+        if (score <= alpha || score >= beta) {
+            searchStats.aspirationResearches++;
+        }
+        if (score <= alpha) {
+            // Only report failed aspiration windows on long searches, to keep the output readable
+            if (timeManager.GetElapsed() > 1000) SendInfo(score, Bound::UPPER_BOUND, GetRootPV(), line);
+            alpha -= delta;
+            delta += delta / 3;
+        }
+        else if (score >= beta) {
+            if (timeManager.GetElapsed() > 1000) SendInfo(score, Bound::LOWER_BOUND, GetRootPV(), line);
+            beta += delta;
+            delta += delta / 3;
+        }
+        else {
+            return score;
+        }
+    }
+}
+
+auto SearchInThread() {
+    searchDepth = 1;
+    // Each line keeps its own score for the aspiration window of the next iteration
+    std::vector<int> scores(std::max(1, std::min(multiPV, CountLegalRootMoves())));
+    std::vector<std::vector<Move>> pvs(scores.size());
+    auto numLines = static_cast<int>(scores.size());
+    while (searchRunning && searchDepth < MAX_SEARCH_DEPTH) {
+        searchDepth++;
+        selDepth = 0;
+        auto nodesBefore = searchStats.GetTotalNodes();
+
+        excludedRootMoves.clear();
+        for (int line = 0; line < numLines; line++) {
+            auto score = SearchRoot(scores[line], line);
+            if (!searchRunning) break;
+            scores[line] = score;
+            pvs[line] = GetRootPV();
+            if (!pvs[line].empty()) excludedRootMoves.push_back(pvs[line][0]);
+        }
+        excludedRootMoves.clear();
+
+        if (searchDepth < MAX_STATS_DEPTH) {
+            searchStats.nodesPerDepth[searchDepth] = searchStats.GetTotalNodes() - nodesBefore;
+        }
+
+        if (!searchRunning) break;
+        depthReached = searchDepth;
+        lastResult = { pvs[0].empty() ? INVALID_MOVE : pvs[0][0], scores[0], searchDepth, pvs[0] };
+        for (int line = 0; line < numLines; line++) {
+            SendInfo(scores[line], Bound::EXACT, pvs[line], line);
+        }
+
+        CheckSignals();
+        if (!searchRunning || !timeManager.ShouldStartIteration(searchDepth, bestMoveSoFar, scores[0])) break;
+    }
+    searchRunning = false;
+}
+
+auto FindBestMoveInTime(const SearchLimits& limits) -> Move {
+    auto bookMove = GetBookMove(theBoard);
+    if (bookMove.has_value()) return *bookMove;
+
+    return SearchBestMove(limits);
+}
+
+auto SearchBestMove(const SearchLimits& limits) -> Move {
+    RegisterSearchStats();
+    searchStats.Reset();
+    depthReached = 1;
+    bestMoveSoFar = INVALID_MOVE;
+    multiPV = std::max(limits.multiPV, 1);
+    lastResult = {};
+    ResetSearchStack();
+    timeManager.Start(limits, theBoard.GetTurn());
+
+    // Mated or stalemated, there is no move to search
+    if (CountLegalRootMoves() == 0) {
+        auto score = IsInCheck(theBoard) ? -MAX_SCORE : 0;
+        lastResult = { INVALID_MOVE, score, 0, {} };
+        if (infoCallback) {
+            infoCallback("info depth 0 score " + FormatScore(score));
+        }
+        return INVALID_MOVE;
+    }
+
+    int tablebaseScore;
+    auto tablebaseMove = ProbeTablebaseRoot(tablebaseScore);
+    if (tablebaseMove != INVALID_MOVE) {
+        searchStats.tablebaseHits++;
+        lastResult = { tablebaseMove, tablebaseScore, 1, { tablebaseMove } };
+        if (infoCallback) {
+            infoCallback("info depth 1 score " + FormatScore(tablebaseScore) + " tbhits 1 pv " + MoveToUCI(tablebaseMove));
+        }
+        return tablebaseMove;
+    }
+
+    searchRunning = true;
+    SearchInThread();
+
+    if (bestMoveSoFar == INVALID_MOVE) {
+        // Stopped before any move was searched, play the first legal move
+        MoveList moves;
+        GenerateLegalMoves(theBoard, moves);
+        if (moves.GetNumMoves() > 0) bestMoveSoFar = moves.GetMove(0);
+    }
+    if (lastResult.bestMove == INVALID_MOVE) {
+        lastResult = { bestMoveSoFar, 0, 0, { bestMoveSoFar } };
+    }
+    return bestMoveSoFar;
+}
+
+auto GetLastSearchResult() -> const SearchResult& {
+    return lastResult;
+}
+
+SearchThread::SearchThread(InfoCallback onInfo) :
+    onInfo(std::move(onInfo)),
+    thread([this]() { Loop(); }) {
+}
+
+SearchThread::~SearchThread() {
+    {
+        std::lock_guard lock(mutex);
+        quit = true;
+        signals.stop = true;
+    }
+    condition.notify_all();
+    thread.join();
+}
+
+void SearchThread::Go(const Board& board, const std::vector<uint64_t>& hashHistory, const SearchLimits& limits, Callback onBestMove) {
+    Stop();
+    Wait();
+    {
+        std::lock_guard lock(mutex);
+        this->board = board;
+        this->hashHistory = hashHistory;
+        this->limits = limits;
+        this->onBestMove = std::move(onBestMove);
+        signals.stop = false;
+        signals.ponderHit = false;
+        searching = true;
+    }
+    condition.notify_all();
+}
+
+void SearchThread::Stop() {
+    {
+        std::lock_guard lock(mutex);
+        signals.stop = true;
+    }
+    condition.notify_all();
+}
+
+void SearchThread::PonderHit() {
+    {
+        std::lock_guard lock(mutex);
+        signals.ponderHit = true;
+    }
+    condition.notify_all();
+}
+
+void SearchThread::Wait() {
+    std::unique_lock lock(mutex);
+    condition.wait(lock, [this]() { return !searching; });
+}
+
+auto SearchThread::IsSearching() -> bool {
+    std::lock_guard lock(mutex);
+    return searching;
+}
+
+void SearchThread::Loop() {
+    searchSignals = &signals;
+    infoCallback = onInfo;
+    while (true) {
+        std::unique_lock lock(mutex);
+        condition.wait(lock, [this]() { return searching || quit; });
+        if (quit) return;
+        theBoard = board;
+        SetHashHistory(hashHistory);
+        auto limits = this->limits;
+        lock.unlock();
+
+        auto move = FindBestMoveInTime(limits);
+
+        // The best move may not be sent before a stop or ponderhit when pondering or searching infinitely
+        lock.lock();
+        condition.wait(lock, [&]() {
+            return signals.stop || quit || (!limits.infinite && (!limits.ponder || signals.ponderHit));
+        });
+        auto onBestMove = std::move(this->onBestMove);
+        lock.unlock();
+
+        if (onBestMove) onBestMove(move);
+
+        lock.lock();
+        searching = false;
+        lock.unlock();
+        condition.notify_all();
+    }
+}
+
+auto IsInMate() -> bool {
+    MoveList moves;
+    GenerateLegalMoves(theBoard, moves);
+    return moves.GetNumMoves() == 0 && IsInCheck(theBoard);
 }
\ No newline at end of file
@@ -1,15 +1,95 @@
-#pragma once
-
-#include "Board.h"
-#include "Move.h"
-
-extern int depthReached;
-extern int numEvaluates;
-extern int numCacheHits;
-extern int numCacheMisses;
-
-auto MinMax(int depth, int alpha, int beta)->int;
-auto FindBestMove()->Move;
-auto FindBestMoveInTime() -> Move;
-auto IsInMate() -> bool;
-void Benchmark();
\ No newline at end of file
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Board.h"
+#include "Move.h"
+#include "MoveOrder.h"
+#include "TimeManager.h"
+
+constexpr int MAX_SEARCH_DEPTH = 64;
+constexpr int MAX_PLY = 128;
+constexpr int MAX_MULTI_PV = 64;
+
+using InfoCallback = std::function<void(const std::string&)>;
+
+// Set from another thread to control a running search
+struct SearchSignals {
+    std::atomic<bool> stop = false;
+    std::atomic<bool> ponderHit = false;
+};
+
+// Last completed iteration of a search
+struct SearchResult {
+    Move bestMove = INVALID_MOVE;
+    int score = 0;
+    int depth = 0;
+    std::vector<Move> pv;
+};
+
+// Per ply state of a search. MinMax and QuiescenceSearch get the entry of their ply and pass the next one down.
+struct SearchStackEntry {
+    int ply = 0;
+    // Evaluation of the position, only set by the nodes that evaluate it
+    int staticEval = 0;
+    // Move being searched from this ply
+    Move currentMove = INVALID_MOVE;
+    Killers killers;
+    // Left out of the search of this ply, which keeps the result out of the transposition table
+    Move excludedMove = INVALID_MOVE;
+    // Best line found from this ply on
+    Move pv[MAX_PLY];
+    int pvLength = 0;
+};
+
+extern thread_local int depthReached;
+
+// Searches the root, ss is the first entry of the search stack
+auto MinMax(SearchStackEntry* ss, int depth, int alpha, int beta)->int;
+auto FindBestMove()->Move;
+auto FindBestMoveInTime(const SearchLimits& limits = { .moveTime = DEFAULT_MOVE_TIME }) -> Move;
+// Same as FindBestMoveInTime, without consulting the book
+auto SearchBestMove(const SearchLimits& limits) -> Move;
+// Result of the last SearchBestMove of the calling thread
+auto GetLastSearchResult() -> const SearchResult&;
+auto FormatScore(int score) -> std::string;
+auto IsInMate() -> bool;
+
+// Persistent worker that searches a copy of the given board, so the caller stays responsive
+class SearchThread {
+public:
+    using Callback = std::function<void(Move)>;
+
+    // onInfo receives the UCI info lines of the search
+    SearchThread(InfoCallback onInfo = {});
+    ~SearchThread();
+
+    // Starts searching, onBestMove is called from the search thread when done.
+    // The hash history holds the positions of the game before the board, see GetHashHistory.
+    void Go(const Board& board, const std::vector<uint64_t>& hashHistory, const SearchLimits& limits, Callback onBestMove);
+    void Stop();
+    void PonderHit();
+    void Wait();
+    auto IsSearching() -> bool;
+
+private:
+    void Loop();
+
+    std::mutex mutex;
+    std::condition_variable condition;
+    SearchSignals signals;
+    InfoCallback onInfo;
+    Board board;
+    std::vector<uint64_t> hashHistory;
+    SearchLimits limits;
+    Callback onBestMove;
+    bool searching = false;
+    bool quit = false;
+    std::thread thread;
+};
\ No newline at end of file
@@ -0,0 +1,141 @@
+#include <algorithm>
+#include <mutex>
+#include <sstream>
+
+#include "SearchStats.h"
+
+thread_local SearchStats searchStats;
+
+namespace {
+    std::mutex registryMutex;
+    std::vector<const SearchStats*> registry;
+
+    // Kept apart from searchStats, so the counters in the hot path do not need a guarded thread_local
+    struct Registration {
+        bool registered = false;
+
+        ~Registration() {
+            if (!registered) return;
+            std::lock_guard lock(registryMutex);
+            std::erase(registry, &searchStats);
+        }
+    };
+
+    thread_local Registration registration;
+
+    void AppendArray(std::ostream& os, const StatCounter* values, int count) {
+        os << "[";
+        for (int i = 0; i < count; i++) {
+            if (i > 0) os << ",";
+            os << values[i];
+        }
+        os << "]";
+    }
+
+    auto GetLastDepth(const SearchStats& stats) -> int {
+        int last = 0;
+        for (int depth = 0; depth < MAX_STATS_DEPTH; depth++) {
+            if (stats.nodesPerDepth[depth] > 0) last = depth;
+        }
+        return last;
+    }
+}
+
+void SearchStats::Reset() {
+    *this = {};
+}
+
+void SearchStats::Merge(const SearchStats& other) {
+    nodes += other.nodes;
+    quiescenceNodes += other.quiescenceNodes;
+    deltaPrunes += other.deltaPrunes;
+    ttProbes += other.ttProbes;
+    ttHits += other.ttHits;
+    for (int i = 0; i < 3; i++) ttCutoffs[i] += other.ttCutoffs[i];
+    tablebaseHits += other.tablebaseHits;
+    for (int i = 0; i < NUM_CUTOFF_INDICES; i++) betaCutoffs[i] += other.betaCutoffs[i];
+    lmrResearches += other.lmrResearches;
+    aspirationResearches += other.aspirationResearches;
+    for (int i = 0; i < MAX_STATS_DEPTH; i++) nodesPerDepth[i] += other.nodesPerDepth[i];
+}
+
+auto SearchStats::ToJson() const -> std::string {
+    std::ostringstream os;
+    os << "{\"nodes\":" << nodes
+        << ",\"quiescenceNodes\":" << quiescenceNodes
+        << ",\"deltaPrunes\":" << deltaPrunes
+        << ",\"ttProbes\":" << ttProbes
+        << ",\"ttHits\":" << ttHits
+        << ",\"ttCutoffs\":{\"exact\":" << ttCutoffs[static_cast<int>(Bound::EXACT)]
+        << ",\"lower\":" << ttCutoffs[static_cast<int>(Bound::LOWER_BOUND)]
+        << ",\"upper\":" << ttCutoffs[static_cast<int>(Bound::UPPER_BOUND)] << "}"
+        << ",\"tablebaseHits\":" << tablebaseHits
+        << ",\"betaCutoffs\":";
+    AppendArray(os, betaCutoffs, NUM_CUTOFF_INDICES);
+    os << ",\"lmrResearches\":" << lmrResearches
+        << ",\"aspirationResearches\":" << aspirationResearches
+        << ",\"nodesPerDepth\":";
+    AppendArray(os, nodesPerDepth, GetLastDepth(*this) + 1);
+    os << "}";
+    return os.str();
+}
+
+auto SearchStats::ToLines() const -> std::vector<std::string> {
+    std::vector<std::string> lines;
+    std::ostringstream os;
+
+    os << "nodes " << nodes << " quiescence " << quiescenceNodes << " delta pruned " << deltaPrunes;
+    lines.push_back(os.str());
+
+    os.str("");
+    os << "tt probes " << ttProbes << " hits " << ttHits
+        << " cutoffs exact " << ttCutoffs[static_cast<int>(Bound::EXACT)]
+        << " lower " << ttCutoffs[static_cast<int>(Bound::LOWER_BOUND)]
+        << " upper " << ttCutoffs[static_cast<int>(Bound::UPPER_BOUND)];
+    lines.push_back(os.str());
+
+    os.str("");
+    os << "tablebase hits " << tablebaseHits;
+    lines.push_back(os.str());
+
+    uint64_t totalCutoffs = 0;
+    for (auto& count : betaCutoffs) totalCutoffs += count;
+    os.str("");
+    os << "beta cutoffs " << totalCutoffs << " by move index";
+    for (int i = 0; i < NUM_CUTOFF_INDICES; i++) {
+        os << " " << (totalCutoffs ? 100.0 * betaCutoffs[i] / totalCutoffs : 0.0) << "%";
+    }
+    lines.push_back(os.str());
+
+    os.str("");
+    os << "researches lmr " << lmrResearches << " aspiration " << aspirationResearches;
+    lines.push_back(os.str());
+
+    auto lastDepth = GetLastDepth(*this);
+    for (int depth = 1; depth <= lastDepth; depth++) {
+        if (nodesPerDepth[depth] == 0) continue;
+        os.str("");
+        os << "depth " << depth << " nodes " << nodesPerDepth[depth];
+        if (nodesPerDepth[depth - 1] > 0) {
+            os << " branching " << static_cast<double>(nodesPerDepth[depth]) / nodesPerDepth[depth - 1];
+        }
+        lines.push_back(os.str());
+    }
+    return lines;
+}
+
+void RegisterSearchStats() {
+    if (registration.registered) return;
+    std::lock_guard lock(registryMutex);
+    registry.push_back(&searchStats);
+    registration.registered = true;
+}
+
+auto GetMergedSearchStats() -> SearchStats {
+    SearchStats merged;
+    std::lock_guard lock(registryMutex);
+    for (auto stats : registry) {
+        merged.Merge(*stats);
+    }
+    return merged;
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "TranspositionTable.h"
+
+constexpr int MAX_STATS_DEPTH = 64;
+constexpr int NUM_CUTOFF_INDICES = 16;
+
+// Only written by the thread that owns it but read by the stats command while that thread searches, a relaxed
+// load and store keeps the read race free without the locked increment of fetch_add
+class StatCounter {
+public:
+    constexpr StatCounter() = default;
+    constexpr StatCounter(uint64_t value) : value(value) {}
+    StatCounter(const StatCounter& other) : value(other.Get()) {}
+
+    auto operator=(const StatCounter& other) -> StatCounter& {
+        value.store(other.Get(), std::memory_order_relaxed);
+        return *this;
+    }
+
+    auto operator++(int) -> uint64_t {
+        auto old = Get();
+        value.store(old + 1, std::memory_order_relaxed);
+        return old;
+    }
+
+    auto operator+=(uint64_t amount) -> StatCounter& {
+        value.store(Get() + amount, std::memory_order_relaxed);
+        return *this;
+    }
+
+    operator uint64_t() const {
+        return Get();
+    }
+
+    auto Get() const -> uint64_t {
+        return value.load(std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<uint64_t> value = 0;
+};
+
+// Counters of one search thread, only written by the thread that owns them
+struct SearchStats {
+    StatCounter nodes = 0;
+    StatCounter quiescenceNodes = 0;
+    // Captures skipped in the quiescence search because they cannot bring the score back to alpha
+    StatCounter deltaPrunes = 0;
+    StatCounter ttProbes = 0;
+    StatCounter ttHits = 0;
+    StatCounter ttCutoffs[3] = {};
+    StatCounter tablebaseHits = 0;
+    // Index of the move in the ordered move list that caused a beta cutoff, the last bucket holds all later moves
+    StatCounter betaCutoffs[NUM_CUTOFF_INDICES] = {};
+    StatCounter lmrResearches = 0;
+    StatCounter aspirationResearches = 0;
+    // Nodes spent on each iteration of iterative deepening
+    StatCounter nodesPerDepth[MAX_STATS_DEPTH] = {};
+
+    auto GetTotalNodes() const -> uint64_t {
+        return nodes + quiescenceNodes;
+    }
+
+    inline void CountTTCutoff(Bound bound) {
+        ttCutoffs[static_cast<int>(bound)]++;
+    }
+
+    inline void CountBetaCutoff(int moveIndex) {
+        betaCutoffs[moveIndex < NUM_CUTOFF_INDICES ? moveIndex : NUM_CUTOFF_INDICES - 1]++;
+    }
+
+    void Reset();
+    void Merge(const SearchStats& other);
+
+    auto ToJson() const -> std::string;
+    auto ToLines() const -> std::vector<std::string>;
+};
+
+extern thread_local SearchStats searchStats;
+
+// Makes the statistics of the calling thread part of the merged statistics, for as long as the thread lives
+void RegisterSearchStats();
+auto GetMergedSearchStats() -> SearchStats;
@@ -0,0 +1,739 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <unordered_map>
+
+#include "MappedFile.h"
+#include "MoveGenerator.h"
+#include "Tablebase.h"
+
+namespace {
+    constexpr char TABLEBASE_MAGIC[8] = { 'C', 'H', 'E', 'S', 'S', 'T', 'B', '1' };
+    constexpr const char* TABLEBASE_EXTENSION = ".tb";
+
+    // Values are relative to the side to move: 1 to 127 mates in that many moves,
+    // TB_LOSS + n gets mated in n moves
+    constexpr uint8_t TB_DRAW = 0;
+    constexpr uint8_t TB_LOSS = 128;
+    constexpr uint8_t TB_INVALID = 255;
+    constexpr int TB_MAX_PLY = 2 * 126;
+    constexpr uint64_t BLOCK_SIZE = 1 << 14;
+
+    struct TablebaseHeader {
+        char magic[8];
+        uint32_t numPieces;
+        uint32_t maxPly;
+        uint8_t pieces[8];
+        uint64_t size;
+    };
+
+    static_assert(sizeof(TablebaseHeader) == 32);
+
+    // Squares are numbered rank * 8 + file
+    struct TbPosition {
+        int numPieces = 0;
+        Piece pieces[MAX_TABLEBASE_PIECES] = {};
+        uint8_t squares[MAX_TABLEBASE_PIECES] = {};
+        Color turn = Color::WHITE;
+    };
+
+    struct Table {
+        std::string name;
+        // White king, other white pieces, black king, other black pieces
+        std::vector<Piece> pieces;
+        bool hasPawns = false;
+        uint64_t size = 0;
+        int maxPly = 0;
+        const uint8_t* values = nullptr;
+        std::unique_ptr<MappedFile> file;
+        std::vector<uint8_t> generated;
+    };
+
+    // The first king is moved to a canonical part of the board by mirroring: a triangle of 10 squares
+    // without pawns, the queen side when there are pawns, since those can only be mirrored left to right
+    struct Symmetry {
+        uint8_t transforms[8][64];
+        int8_t kingIndex[2][64];
+        uint8_t kingSquares[2][32];
+        int numKingSquares[2] = {};
+    };
+
+    auto CreateSymmetry() -> Symmetry {
+        Symmetry symmetry;
+        for (int transform = 0; transform < 8; transform++) {
+            for (int square = 0; square < 64; square++) {
+                int rank = square / 8;
+                int file = square % 8;
+                if (transform & 4) std::swap(rank, file);
+                if (transform & 2) rank = 7 - rank;
+                if (transform & 1) file = 7 - file;
+                symmetry.transforms[transform][square] = static_cast<uint8_t>(rank * 8 + file);
+            }
+        }
+        for (int pawns = 0; pawns < 2; pawns++) {
+            for (int square = 0; square < 64; square++) {
+                int rank = square / 8;
+                int file = square % 8;
+                auto canonical = pawns ? file <= 3 : file <= 3 && rank <= file;
+                symmetry.kingIndex[pawns][square] = -1;
+                if (canonical) {
+                    symmetry.kingIndex[pawns][square] = static_cast<int8_t>(symmetry.numKingSquares[pawns]);
+                    symmetry.kingSquares[pawns][symmetry.numKingSquares[pawns]++] = static_cast<uint8_t>(square);
+                }
+            }
+        }
+        return symmetry;
+    }
+
+    const Symmetry symmetry = CreateSymmetry();
+
+    std::unordered_map<uint64_t, Table> tables;
+
+    // The white piece of the same type
+    auto GetType(Piece piece) -> Piece {
+        return static_cast<Piece>(GetPieceType(piece));
+    }
+
+    // Files number the pieces without gap between the colors, white 1 to 6 and black 7 to 12
+    auto EncodeFilePiece(Piece piece) -> uint8_t {
+        return static_cast<uint8_t>(static_cast<int>(GetPieceType(piece)) + (IsBlackPiece(piece) ? 6 : 0));
+    }
+
+    auto DecodeFilePiece(uint8_t value) -> Piece {
+        return value > 6 ? InvertPiece(static_cast<Piece>(value - 6)) : static_cast<Piece>(value);
+    }
+
+    auto GetLetter(Piece piece) -> char {
+        switch (GetType(piece)) {
+        case Piece::WHITE_KING: return 'K';
+        case Piece::WHITE_QUEEN: return 'Q';
+        case Piece::WHITE_ROOK: return 'R';
+        case Piece::WHITE_BISHOP: return 'B';
+        case Piece::WHITE_KNIGHT: return 'N';
+        default: return 'P';
+        }
+    }
+
+    auto GetOrder(Piece piece) -> int {
+        return static_cast<int>(std::string_view("KQRBNP").find(GetLetter(piece)));
+    }
+
+    auto GetValue(Piece piece) -> int {
+        switch (GetType(piece)) {
+        case Piece::WHITE_QUEEN: return 9;
+        case Piece::WHITE_ROOK: return 5;
+        case Piece::WHITE_BISHOP: return 3;
+        case Piece::WHITE_KNIGHT: return 3;
+        case Piece::WHITE_PAWN: return 1;
+        default: return 0;
+        }
+    }
+
+    // Independent of the order of the pieces
+    auto GetMaterialKey(const Piece* pieces, int numPieces) -> uint64_t {
+        uint64_t key = 0;
+        for (int i = 0; i < numPieces; i++) {
+            key += uint64_t{ 1 } << (4 * (static_cast<int>(pieces[i]) - 1));
+        }
+        return key;
+    }
+
+    // Puts the pieces in table order, with the stronger side as white
+    auto CanonicalizeMaterial(std::vector<Piece> pieces) -> std::vector<Piece> {
+        auto sideName = [&](Color color) {
+            std::string name;
+            for (auto piece : pieces) {
+                if (GetColorOfPiece(piece) == color) name += GetLetter(piece);
+            }
+            return name;
+        };
+        auto sideValue = [&](Color color) {
+            int value = 0;
+            for (auto piece : pieces) {
+                if (GetColorOfPiece(piece) == color) value += GetValue(piece);
+            }
+            return value;
+        };
+
+        auto order = [](Piece a, Piece b) {
+            if (GetColorOfPiece(a) != GetColorOfPiece(b)) return GetColorOfPiece(a) == Color::WHITE;
+            return GetOrder(a) < GetOrder(b);
+        };
+        std::sort(pieces.begin(), pieces.end(), order);
+
+        auto whiteValue = sideValue(Color::WHITE);
+        auto blackValue = sideValue(Color::BLACK);
+        if (blackValue > whiteValue || (blackValue == whiteValue && sideName(Color::BLACK) > sideName(Color::WHITE))) {
+            for (auto& piece : pieces) piece = InvertPiece(piece);
+            std::sort(pieces.begin(), pieces.end(), order);
+        }
+        return pieces;
+    }
+
+    auto GetMaterialName(const std::vector<Piece>& pieces) -> std::string {
+        std::string name;
+        for (size_t i = 0; i < pieces.size(); i++) {
+            if (i > 0 && GetColorOfPiece(pieces[i]) == Color::BLACK && GetColorOfPiece(pieces[i - 1]) == Color::WHITE) name += 'v';
+            name += GetLetter(pieces[i]);
+        }
+        return name;
+    }
+
+    // Material like "KQvKR", empty when invalid
+    auto ParseMaterial(const std::string& name) -> std::vector<Piece> {
+        auto separator = name.find('v');
+        if (separator == std::string::npos) return {};
+        std::vector<Piece> pieces;
+        for (size_t i = 0; i < name.size(); i++) {
+            if (i == separator) continue;
+            auto color = i < separator ? Color::WHITE : Color::BLACK;
+            Piece piece;
+            switch (name[i]) {
+            case 'K': piece = Piece::WHITE_KING; break;
+            case 'Q': piece = Piece::WHITE_QUEEN; break;
+            case 'R': piece = Piece::WHITE_ROOK; break;
+            case 'B': piece = Piece::WHITE_BISHOP; break;
+            case 'N': piece = Piece::WHITE_KNIGHT; break;
+            case 'P': piece = Piece::WHITE_PAWN; break;
+            default: return {};
+            }
+            pieces.push_back(color == Color::WHITE ? piece : InvertPiece(piece));
+        }
+        if (std::count(pieces.begin(), pieces.end(), Piece::WHITE_KING) != 1 || std::count(pieces.begin(), pieces.end(), Piece::BLACK_KING) != 1) return {};
+        if (pieces.size() < 3 || pieces.size() > MAX_TABLEBASE_PIECES) return {};
+        return CanonicalizeMaterial(pieces);
+    }
+
+    auto CreateTable(const std::vector<Piece>& pieces) -> Table {
+        Table table;
+        table.pieces = pieces;
+        table.name = GetMaterialName(pieces);
+        table.hasPawns = std::any_of(pieces.begin(), pieces.end(), [](Piece piece) { return GetType(piece) == Piece::WHITE_PAWN; });
+        table.size = 2 * symmetry.numKingSquares[table.hasPawns];
+        for (size_t i = 1; i < pieces.size(); i++) {
+            table.size *= 64 - i;
+        }
+        return table;
+    }
+
+    // The squares of the other pieces are numbered skipping the squares of the earlier pieces
+    auto GetIndex(const Table& table, const TbPosition& position) -> uint64_t {
+        int transform = 0;
+        while (symmetry.kingIndex[table.hasPawns][symmetry.transforms[transform][position.squares[0]]] < 0) transform++;
+
+        uint8_t placed[MAX_TABLEBASE_PIECES];
+        placed[0] = symmetry.transforms[transform][position.squares[0]];
+        uint64_t index = (position.turn == Color::WHITE ? 0 : 1) * symmetry.numKingSquares[table.hasPawns]
+            + symmetry.kingIndex[table.hasPawns][placed[0]];
+        for (int i = 1; i < position.numPieces; i++) {
+            auto square = symmetry.transforms[transform][position.squares[i]];
+            int below = 0;
+            for (int j = 0; j < i; j++) {
+                if (placed[j] < square) below++;
+            }
+            placed[i] = square;
+            index = index * (64 - i) + (square - below);
+        }
+        return index;
+    }
+
+    auto GetPosition(const Table& table, uint64_t index) -> TbPosition {
+        TbPosition position;
+        position.numPieces = static_cast<int>(table.pieces.size());
+        int numbers[MAX_TABLEBASE_PIECES];
+        for (int i = position.numPieces - 1; i >= 1; i--) {
+            numbers[i] = static_cast<int>(index % (64 - i));
+            index /= 64 - i;
+        }
+        auto numKingSquares = symmetry.numKingSquares[table.hasPawns];
+        position.squares[0] = symmetry.kingSquares[table.hasPawns][index % numKingSquares];
+        position.turn = index / numKingSquares == 0 ? Color::WHITE : Color::BLACK;
+
+        uint8_t sorted[MAX_TABLEBASE_PIECES] = { position.squares[0] };
+        for (int i = 1; i < position.numPieces; i++) {
+            int square = numbers[i];
+            for (int j = 0; j < i; j++) {
+                if (sorted[j] <= square) square++;
+            }
+            position.squares[i] = static_cast<uint8_t>(square);
+            // Insertion keeps the earlier squares ascending
+            int j = i;
+            while (j > 0 && sorted[j - 1] > square) {
+                sorted[j] = sorted[j - 1];
+                j--;
+            }
+            sorted[j] = static_cast<uint8_t>(square);
+        }
+        for (int i = 0; i < position.numPieces; i++) {
+            position.pieces[i] = table.pieces[i];
+        }
+        return position;
+    }
+
+    auto GetOccupied(const TbPosition& position) -> uint64_t {
+        uint64_t occupied = 0;
+        for (int i = 0; i < position.numPieces; i++) {
+            occupied |= uint64_t{ 1 } << position.squares[i];
+        }
+        return occupied;
+    }
+
+    auto Attacks(Piece piece, int from, int target, uint64_t occupied) -> bool {
+        int rankDistance = target / 8 - from / 8;
+        int fileDistance = target % 8 - from % 8;
+        auto type = GetType(piece);
+        switch (type) {
+        case Piece::WHITE_PAWN:
+            return std::abs(fileDistance) == 1 && rankDistance == (piece == Piece::WHITE_PAWN ? 1 : -1);
+        case Piece::WHITE_KNIGHT:
+            return std::abs(rankDistance * fileDistance) == 2;
+        case Piece::WHITE_KING:
+            return std::max(std::abs(rankDistance), std::abs(fileDistance)) == 1;
+        default:
+            break;
+        }
+        auto straight = rankDistance == 0 || fileDistance == 0;
+        auto diagonal = std::abs(rankDistance) == std::abs(fileDistance);
+        if (type == Piece::WHITE_ROOK && !straight) return false;
+        if (type == Piece::WHITE_BISHOP && !diagonal) return false;
+        if (!straight && !diagonal) return false;
+        auto step = (rankDistance > 0) - (rankDistance < 0);
+        step = step * 8 + (fileDistance > 0) - (fileDistance < 0);
+        for (auto square = from + step; square != target; square += step) {
+            if (occupied & (uint64_t{ 1 } << square)) return false;
+        }
+        return true;
+    }
+
+    auto IsKingAttacked(const TbPosition& position, Color color) -> bool {
+        auto occupied = GetOccupied(position);
+        auto king = color == Color::WHITE ? Piece::WHITE_KING : Piece::BLACK_KING;
+        int kingSquare = 0;
+        for (int i = 0; i < position.numPieces; i++) {
+            if (position.pieces[i] == king) kingSquare = position.squares[i];
+        }
+        for (int i = 0; i < position.numPieces; i++) {
+            if (GetColorOfPiece(position.pieces[i]) == color) continue;
+            if (Attacks(position.pieces[i], position.squares[i], kingSquare, occupied)) return true;
+        }
+        return false;
+    }
+
+    auto IsValid(const TbPosition& position) -> bool {
+        for (int i = 0; i < position.numPieces; i++) {
+            auto rank = position.squares[i] / 8;
+            if (GetType(position.pieces[i]) == Piece::WHITE_PAWN && (rank == 0 || rank == 7)) return false;
+        }
+        // The side to move cannot be able to capture the king
+        return !IsKingAttacked(position, InvertColor(position.turn));
+    }
+
+    // Calls onMove with the position after each legal move and whether that position is in another table.
+    // Castling and en passant do not exist in the tables, pawns always promote to a queen like in DoMove.
+    template<typename OnMove>
+    void ForEachLegalMove(const TbPosition& position, OnMove&& onMove) {
+        static constexpr int kingSteps[8][2] = { {1, 0}, {1, 1}, {0, 1}, {-1, 1}, {-1, 0}, {-1, -1}, {0, -1}, {1, -1} };
+        static constexpr int knightSteps[8][2] = { {2, 1}, {1, 2}, {-1, 2}, {-2, 1}, {-2, -1}, {-1, -2}, {1, -2}, {2, -1} };
+
+        auto pieceAt = [&](int square) {
+            for (int i = 0; i < position.numPieces; i++) {
+                if (position.squares[i] == square) return i;
+            }
+            return -1;
+        };
+
+        // Returns false when the square is occupied, so slides stop there
+        auto tryMove = [&](int index, int rank, int file, bool allowCapture, bool allowQuiet) {
+            if (rank < 0 || rank > 7 || file < 0 || file > 7) return false;
+            auto to = rank * 8 + file;
+            auto captured = pieceAt(to);
+            if (captured >= 0) {
+                if (allowCapture && GetColorOfPiece(position.pieces[captured]) != position.turn && GetType(position.pieces[captured]) != Piece::WHITE_KING) {
+                    TbPosition child = position;
+                    child.squares[index] = static_cast<uint8_t>(to);
+                    if (GetType(child.pieces[index]) == Piece::WHITE_PAWN && (rank == 0 || rank == 7)) {
+                        child.pieces[index] = position.turn == Color::WHITE ? Piece::WHITE_QUEEN : Piece::BLACK_QUEEN;
+                    }
+                    for (int i = captured; i < child.numPieces - 1; i++) {
+                        child.pieces[i] = child.pieces[i + 1];
+                        child.squares[i] = child.squares[i + 1];
+                    }
+                    child.numPieces--;
+                    child.turn = InvertColor(position.turn);
+                    if (!IsKingAttacked(child, position.turn)) onMove(child, true);
+                }
+                return false;
+            }
+            if (allowQuiet) {
+                TbPosition child = position;
+                child.squares[index] = static_cast<uint8_t>(to);
+                auto promotion = GetType(child.pieces[index]) == Piece::WHITE_PAWN && (rank == 0 || rank == 7);
+                if (promotion) {
+                    child.pieces[index] = position.turn == Color::WHITE ? Piece::WHITE_QUEEN : Piece::BLACK_QUEEN;
+                }
+                child.turn = InvertColor(position.turn);
+                if (!IsKingAttacked(child, position.turn)) onMove(child, promotion);
+            }
+            return true;
+        };
+
+        for (int i = 0; i < position.numPieces; i++) {
+            auto piece = position.pieces[i];
+            if (GetColorOfPiece(piece) != position.turn) continue;
+            int rank = position.squares[i] / 8;
+            int file = position.squares[i] % 8;
+            auto type = GetType(piece);
+
+            if (type == Piece::WHITE_PAWN) {
+                auto forward = piece == Piece::WHITE_PAWN ? 1 : -1;
+                auto startRank = piece == Piece::WHITE_PAWN ? 1 : 6;
+                if (tryMove(i, rank + forward, file, false, true) && rank == startRank) {
+                    tryMove(i, rank + 2 * forward, file, false, true);
+                }
+                tryMove(i, rank + forward, file - 1, true, false);
+                tryMove(i, rank + forward, file + 1, true, false);
+            }
+            else if (type == Piece::WHITE_KING || type == Piece::WHITE_KNIGHT) {
+                auto& steps = type == Piece::WHITE_KING ? kingSteps : knightSteps;
+                for (auto& step : steps) {
+                    tryMove(i, rank + step[0], file + step[1], true, true);
+                }
+            }
+            else {
+                for (int direction = 0; direction < 8; direction++) {
+                    auto diagonal = direction % 2 == 1;
+                    if (type == Piece::WHITE_ROOK && diagonal) continue;
+                    if (type == Piece::WHITE_BISHOP && !diagonal) continue;
+                    for (int distance = 1; ; distance++) {
+                        if (!tryMove(i, rank + distance * kingSteps[direction][0], file + distance * kingSteps[direction][1], true, true)) break;
+                    }
+                }
+            }
+        }
+    }
+
+    // Value of a position with the pieces in any order, -1 when there is no table for it
+    auto LookupValue(const TbPosition& position) -> int {
+        if (position.numPieces == 2) return TB_DRAW;
+
+        auto key = GetMaterialKey(position.pieces, position.numPieces);
+        auto it = tables.find(key);
+        auto flip = false;
+        if (it == tables.end()) {
+            Piece flipped[MAX_TABLEBASE_PIECES];
+            for (int i = 0; i < position.numPieces; i++) flipped[i] = InvertPiece(position.pieces[i]);
+            it = tables.find(GetMaterialKey(flipped, position.numPieces));
+            if (it == tables.end()) return -1;
+            flip = true;
+        }
+        auto& table = it->second;
+
+        // Colors are swapped by mirroring the board top to bottom
+        TbPosition ordered;
+        ordered.numPieces = position.numPieces;
+        ordered.turn = flip ? InvertColor(position.turn) : position.turn;
+        bool used[MAX_TABLEBASE_PIECES] = {};
+        for (int slot = 0; slot < ordered.numPieces; slot++) {
+            for (int i = 0; i < position.numPieces; i++) {
+                auto piece = flip ? InvertPiece(position.pieces[i]) : position.pieces[i];
+                if (used[i] || piece != table.pieces[slot]) continue;
+                used[i] = true;
+                ordered.pieces[slot] = piece;
+                ordered.squares[slot] = flip ? static_cast<uint8_t>(position.squares[i] ^ 56) : position.squares[i];
+                break;
+            }
+        }
+        return table.values[GetIndex(table, ordered)];
+    }
+
+    auto IsWin(int value) -> bool {
+        return value > TB_DRAW && value < TB_LOSS;
+    }
+
+    auto IsLoss(int value) -> bool {
+        return value >= TB_LOSS && value < TB_INVALID;
+    }
+
+    auto ValueToScore(int value) -> int {
+        if (IsWin(value)) return MAX_SCORE - (2 * value - 1);
+        if (IsLoss(value)) return -(MAX_SCORE - 2 * (value - TB_LOSS));
+        return 0;
+    }
+
+    using Changes = std::vector<std::pair<uint64_t, uint8_t>>;
+
+    // Visits all indices of the table on the threads, the changes are applied once all threads are done,
+    // so every visit sees the values of the previous pass
+    auto RunPass(Table& table, int threads, const std::function<void(uint64_t, Changes&)>& visit) -> uint64_t {
+        std::atomic<uint64_t> nextBlock = 0;
+        std::vector<Changes> changes(threads);
+        std::vector<std::thread> workers;
+        for (int i = 0; i < threads; i++) {
+            workers.emplace_back([&, i]() {
+                while (true) {
+                    auto begin = nextBlock++ * BLOCK_SIZE;
+                    if (begin >= table.size) return;
+                    auto end = std::min(begin + BLOCK_SIZE, table.size);
+                    for (auto index = begin; index < end; index++) {
+                        visit(index, changes[i]);
+                    }
+                }
+            });
+        }
+        for (auto& worker : workers) {
+            worker.join();
+        }
+
+        uint64_t numChanges = 0;
+        for (auto& threadChanges : changes) {
+            for (auto [index, value] : threadChanges) {
+                table.generated[index] = value;
+            }
+            numChanges += threadChanges.size();
+        }
+        return numChanges;
+    }
+
+    void GenerateTable(Table& table, int threads, int maxSubPly) {
+        table.generated.assign(table.size, TB_DRAW);
+        table.values = table.generated.data();
+
+        auto childValue = [&](const TbPosition& child, bool otherTable) {
+            return otherTable ? LookupValue(child) : table.values[GetIndex(table, child)];
+        };
+
+        // Mates, stalemates stay a draw
+        RunPass(table, threads, [&](uint64_t index, Changes& changes) {
+            auto position = GetPosition(table, index);
+            if (!IsValid(position)) {
+                changes.push_back({ index, TB_INVALID });
+                return;
+            }
+            bool hasMoves = false;
+            ForEachLegalMove(position, [&](const TbPosition&, bool) { hasMoves = true; });
+            if (!hasMoves && IsKingAttacked(position, position.turn)) {
+                changes.push_back({ index, TB_LOSS });
+            }
+        });
+
+        // A position is won in n plies when a move leads to a loss in less than n plies, and lost in n plies when
+        // every move leads to a win in less than n plies. Wins take an odd number of plies, losses an even number.
+        int lastChange = 0;
+        for (int ply = 1; ply <= TB_MAX_PLY; ply++) {
+            if (ply - lastChange > 2 && ply > maxSubPly + 1) break;
+
+            auto numChanges = RunPass(table, threads, [&](uint64_t index, Changes& changes) {
+                if (table.values[index] != TB_DRAW) return;
+                auto position = GetPosition(table, index);
+                if (ply % 2 == 1) {
+                    bool win = false;
+                    ForEachLegalMove(position, [&](const TbPosition& child, bool otherTable) {
+                        if (win) return;
+                        auto value = childValue(child, otherTable);
+                        if (IsLoss(value) && 2 * (value - TB_LOSS) < ply) win = true;
+                    });
+                    if (win) changes.push_back({ index, static_cast<uint8_t>((ply + 1) / 2) });
+                }
+                else {
+                    bool hasMoves = false;
+                    bool loss = true;
+                    ForEachLegalMove(position, [&](const TbPosition& child, bool otherTable) {
+                        hasMoves = true;
+                        if (!loss) return;
+                        auto value = childValue(child, otherTable);
+                        if (!IsWin(value) || 2 * value - 1 >= ply) loss = false;
+                    });
+                    if (hasMoves && loss) changes.push_back({ index, static_cast<uint8_t>(TB_LOSS + ply / 2) });
+                }
+            });
+
+            if (numChanges > 0) {
+                lastChange = ply;
+                table.maxPly = ply;
+            }
+        }
+    }
+
+    auto GetFileName(const std::string& directory, const std::string& name) -> std::string {
+        return (std::filesystem::path(directory) / (name + TABLEBASE_EXTENSION)).string();
+    }
+
+    auto WriteTable(const Table& table, const std::string& directory) -> bool {
+        TablebaseHeader header = {};
+        std::memcpy(header.magic, TABLEBASE_MAGIC, sizeof(TABLEBASE_MAGIC));
+        header.numPieces = static_cast<uint32_t>(table.pieces.size());
+        header.maxPly = static_cast<uint32_t>(table.maxPly);
+        for (size_t i = 0; i < table.pieces.size(); i++) {
+            header.pieces[i] = EncodeFilePiece(table.pieces[i]);
+        }
+        header.size = table.size;
+
+        std::error_code error;
+        std::filesystem::create_directories(directory, error);
+        std::ofstream os(GetFileName(directory, table.name), std::ios::binary | std::ios::trunc);
+        os.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        os.write(reinterpret_cast<const char*>(table.values), table.size);
+        return static_cast<bool>(os);
+    }
+
+    auto MapTable(const std::string& fileName) -> bool {
+        auto file = std::make_unique<MappedFile>();
+        if (!file->Open(fileName) || file->GetSize() < sizeof(TablebaseHeader)) return false;
+
+        auto header = reinterpret_cast<const TablebaseHeader*>(file->GetData());
+        if (std::memcmp(header->magic, TABLEBASE_MAGIC, sizeof(TABLEBASE_MAGIC)) != 0 || header->numPieces > MAX_TABLEBASE_PIECES) return false;
+
+        std::vector<Piece> pieces;
+        for (uint32_t i = 0; i < header->numPieces; i++) {
+            pieces.push_back(DecodeFilePiece(header->pieces[i]));
+        }
+        auto table = CreateTable(pieces);
+        if (pieces != CanonicalizeMaterial(pieces) || header->size != table.size || file->GetSize() != sizeof(TablebaseHeader) + table.size) return false;
+
+        table.maxPly = static_cast<int>(header->maxPly);
+        table.values = file->GetData() + sizeof(TablebaseHeader);
+        table.file = std::move(file);
+        auto key = GetMaterialKey(table.pieces.data(), static_cast<int>(table.pieces.size()));
+        tables[key] = std::move(table);
+        return true;
+    }
+
+    // Makes sure the table and the tables it leads to are available, generating the missing ones.
+    // Returns the longest distance to mate in plies of the table.
+    auto ProvideTable(const std::vector<Piece>& pieces, const std::string& directory, int threads) -> int {
+        auto key = GetMaterialKey(pieces.data(), static_cast<int>(pieces.size()));
+        if (auto it = tables.find(key); it != tables.end()) return it->second.maxPly;
+        auto table = CreateTable(pieces);
+        if (MapTable(GetFileName(directory, table.name))) return tables[key].maxPly;
+
+        // Tables after a capture or a promotion
+        int maxSubPly = 0;
+        for (size_t i = 0; i < pieces.size(); i++) {
+            if (GetType(pieces[i]) == Piece::WHITE_KING) continue;
+            auto captured = pieces;
+            captured.erase(captured.begin() + i);
+            if (captured.size() > 2) {
+                maxSubPly = std::max(maxSubPly, ProvideTable(CanonicalizeMaterial(captured), directory, threads));
+            }
+            if (GetType(pieces[i]) == Piece::WHITE_PAWN) {
+                auto promoted = pieces;
+                promoted[i] = GetColorOfPiece(pieces[i]) == Color::WHITE ? Piece::WHITE_QUEEN : Piece::BLACK_QUEEN;
+                maxSubPly = std::max(maxSubPly, ProvideTable(CanonicalizeMaterial(promoted), directory, threads));
+            }
+        }
+
+        auto startTime = std::chrono::steady_clock::now();
+        GenerateTable(table, threads, maxSubPly);
+        auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime).count();
+        std::cout << table.name << ": " << table.size << " positions, longest mate " << (table.maxPly + 1) / 2
+            << " moves, " << ms << " ms" << std::endl;
+
+        if (!WriteTable(table, directory)) {
+            std::cerr << "Cannot write " << GetFileName(directory, table.name) << "\n";
+        }
+        auto maxPly = table.maxPly;
+        tables[key] = std::move(table);
+        return maxPly;
+    }
+
+    // Castling is not in the tables, the rights only matter while the king and rook are at home
+    auto MightCastle(const Board& board) -> bool {
+        for (auto color : { Color::WHITE, Color::BLACK }) {
+            int8_t rank = color == Color::WHITE ? 0 : 7;
+            auto king = color == Color::WHITE ? Piece::WHITE_KING : Piece::BLACK_KING;
+            auto rook = color == Color::WHITE ? Piece::WHITE_ROOK : Piece::BLACK_ROOK;
+            if (board({ rank, 4 }) != king) continue;
+            if (board.HasCastlingRights(color, CastlingSide::QUEEN) && board({ rank, 0 }) == rook) return true;
+            if (board.HasCastlingRights(color, CastlingSide::KING) && board({ rank, 7 }) == rook) return true;
+        }
+        return false;
+    }
+}
+
+auto GenerateTablebases(const std::vector<std::string>& names, const std::string& directory, int threads) -> bool {
+    if (threads <= 0) threads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    for (auto& name : names) {
+        auto pieces = ParseMaterial(name);
+        if (pieces.empty()) {
+            std::cerr << "Invalid material " << name << ", expected 3 or 4 pieces like KQvKR\n";
+            return false;
+        }
+        ProvideTable(pieces, directory, threads);
+    }
+    return true;
+}
+
+auto LoadTablebases(const std::string& directory) -> int {
+    std::error_code error;
+    int numTables = 0;
+    for (auto& entry : std::filesystem::directory_iterator(directory, error)) {
+        if (entry.path().extension() != TABLEBASE_EXTENSION) continue;
+        if (MapTable(entry.path().string())) numTables++;
+        else std::cerr << "Invalid tablebase " << entry.path().string() << "\n";
+    }
+    return numTables;
+}
+
+auto ProbeTablebase(const Board& board, int& score) -> bool {
+    if (tables.empty()) return false;
+    if (board.GetCastlingRights() != 0 && MightCastle(board)) return false;
+
+    TbPosition position;
+    bool hasPawn = false;
+    for (int8_t rank = 0; rank < 8; rank++) {
+        for (int8_t file = 0; file < 8; file++) {
+            auto piece = board({ rank, file });
+            if (piece == Piece::NO_PIECE) continue;
+            if (position.numPieces == MAX_TABLEBASE_PIECES) return false;
+            position.pieces[position.numPieces] = piece;
+            position.squares[position.numPieces++] = static_cast<uint8_t>(rank * 8 + file);
+            if (GetColorOfPiece(piece) == board.GetTurn() && GetType(piece) == Piece::WHITE_PAWN) hasPawn = true;
+        }
+    }
+    // En passant is not in the tables, it only matters when the side to move has a pawn
+    if (hasPawn && board.GetEnPassentFile() != INVALID_ENPASSENT_FILE) return false;
+    position.turn = board.GetTurn();
+
+    auto value = LookupValue(position);
+    if (value < 0 || value == TB_INVALID) return false;
+    score = ValueToScore(value);
+    return true;
+}
+
+auto ProbeTablebaseRoot(int& score) -> Move {
+    int rootScore;
+    if (!ProbeTablebase(theBoard, rootScore)) return INVALID_MOVE;
+
+    MoveList moves;
+    GenerateMoves(theBoard, moves);
+    auto bestMove = INVALID_MOVE;
+    auto bestScore = -MAX_SCORE - 1;
+    for (auto move : moves) {
+        if (!IsMoveValid(theBoard, move)) continue;
+        DoMove(move);
+        theBoard.SwitchTurn();
+        int childScore;
+        auto found = ProbeTablebase(theBoard, childScore);
+        theBoard.SwitchTurn();
+        UndoMove();
+        if (!found) return INVALID_MOVE;
+
+        // One ply further from the mate than the child
+        auto moveScore = -childScore;
+        if (moveScore > MATE_THRESHOLD) moveScore--;
+        if (moveScore < -MATE_THRESHOLD) moveScore++;
+        if (moveScore > bestScore) {
+            bestScore = moveScore;
+            bestMove = move;
+        }
+    }
+    score = bestScore;
+    return bestMove;
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "Board.h"
+#include "Move.h"
+
+constexpr int MAX_TABLEBASE_PIECES = 4;
+constexpr const char* DEFAULT_TABLEBASE_DIRECTORY = "Tablebases";
+
+// Generates the tables of material sets like "KQvKR" with retrograde analysis, together with the smaller
+// tables they lead to, and writes them to the directory. Zero threads uses all cores.
+auto GenerateTablebases(const std::vector<std::string>& names, const std::string& directory, int threads) -> bool;
+
+// Maps the tables in the directory into memory, returns the number of tables
+auto LoadTablebases(const std::string& directory = DEFAULT_TABLEBASE_DIRECTORY) -> int;
+
+// Score relative to the side to move, mates score MAX_SCORE minus the plies to the mate from this position
+auto ProbeTablebase(const Board& board, int& score) -> bool;
+
+// Best move of theBoard by the tables, INVALID_MOVE when the position or one of its moves is not in a table
+auto ProbeTablebaseRoot(int& score) -> Move;
@@ -1,231 +1,456 @@
-#include <cassert>
-#include <iostream>
-
-#include "MoveGenerator.h"
-#include "Search.h"
-
-
-#define ASSERT(x) AssertImpl(x, #x)
-
-auto AssertImpl(bool condition, std::string check) {
-	if (condition) return;
-	std::cout << "Assertion " << check << " failed\n";
-}
-
-
-void TestCastling() {
-	std::cout << "TestCastling\n";
-	
-	Board board;
-	ParseBoard(board,
-		"...K...."
-		"........"
-		"........"
-		"........"
-		"........"
-		"........"
-		"........"
-		"....k..r"
-	);
-	ASSERT(IsMoveValid(board, ParseMove("E1G1")));
-
-	// Cannot castle when in check
-	ParseBoard(board,
-		"...KQ..."
-		"........"
-		"........"
-		"........"
-		"........"
-		"........"
-		"........"
-		"....k..r"
-	);
-	ASSERT(!IsMoveValid(board, ParseMove("E1G1")));
-	
-	ParseBoard(board,
-		"...K.Q.."
-		"........"
-		"........"
-		"........"
-		"........"
-		"........"
-		"........"
-		"....k..r"
-	);
-	ASSERT(!IsMoveValid(board, ParseMove("E1G1")));
-	
-	ParseBoard(board,
-		"...K..Q."
-		"........"
-		"........"
-		"........"
-		"........"
-		"........"
-		"........"
-		"....k..r"
-	);
-	ASSERT(!IsMoveValid(board, ParseMove("E1G1")));
-
-	ParseBoard(board,
-		"...K...."
-		"........"
-		"........"
-		"........"
-		"........"
-		"........"
-		"........"
-		"r...k..r"
-	);
-	ASSERT(IsMoveValid(board, ParseMove("E1C1")));
-
-	ParseBoard(board,
-		"...KQ..."
-		"........"
-		"........"
-		"........"
-		"........"
-		"........"
-		"........"
-		"r...k..r"
-	);
-	ASSERT(!IsMoveValid(board, ParseMove("E1C1")));
-
-	ParseBoard(board,
-		"...Q...K"
-		"........"
-		"........"
-		"........"
-		"........"
-		"........"
-		"........"
-		"r...k..r"
-	);
-	ASSERT(!IsMoveValid(board, ParseMove("E1C1")));
-
-	ParseBoard(board,
-		"..Q....K"
-		"........"
-		"........"
-		"........"
-		"........"
-		"........"
-		"........"
-		"r...k..r"
-	);
-	ASSERT(!IsMoveValid(board, ParseMove("E1C1")));
-
-	ParseBoard(board,
-		".Q.....K"
-		"........"
-		"........"
-		"........"
-		"........"
-		"........"
-		"........"
-		"r...k..r"
-	);
-	ASSERT(IsMoveValid(board, ParseMove("E1C1")));
-
-	ParseBoard(board,
-		"Q......K"
-		".P......"
-		"........"
-		"........"
-		"........"
-		"........"
-		"........"
-		"r...k..r"
-	);
-	ASSERT(IsMoveValid(board, ParseMove("E1C1")));
-
-	// Test castling rights
-	ParseBoard(theBoard,
-		".......K"
-		"........"
-		"........"
-		"........"
-		"........"
-		"........"
-		"........"
-		"r...k..r"
-	);
-
-	ASSERT(IsMoveValid(theBoard, ParseMove("E1G1")));
-	ASSERT(theBoard.HasCastlingRights(CastlingSide::KING));
-	ASSERT(IsMoveValid(theBoard, ParseMove("H1H2")));
-	DoMove(ParseMove("H1H2"));
-	ASSERT(!theBoard.HasCastlingRights(CastlingSide::KING));
-	theBoard.SwitchTurn();
-	DoMove(ParseMove("H8H7"));
-	theBoard.SwitchTurn();
-	DoMove(ParseMove("H2H1"));
-	theBoard.SwitchTurn();
-	ASSERT(!IsMoveValid(theBoard, ParseMove("E1G1")));
-
-	ParseBoard(theBoard,
-		".......K"
-		"........"
-		"........"
-		"........"
-		"........"
-		"........"
-		"........"
-		"r...k..r"
-	);
-	ASSERT(IsMoveValid(theBoard, ParseMove("E1G1")));
-	DoMove(ParseMove("E1F1"));
-	theBoard.SwitchTurn();
-	DoMove(ParseMove("H8G8"));
-	theBoard.SwitchTurn();
-	DoMove(ParseMove("F1E1"));
-	theBoard.SwitchTurn();
-	DoMove(ParseMove("G8H8"));
-	ASSERT(!IsMoveValid(theBoard, ParseMove("E1G1")));
-}
-
-
-void TestMate() {
-	ParseBoard(theBoard,
-		"........"
-		"........"
-		"........"
-		"........"
-		"........"
-		"....K..."
-		"....Q..."
-		"r...k..r"
-	);
-	ASSERT(IsInMate());
-}
-
-void TestEnPassant() {
-	ParseBoard(theBoard,
-		"....K..."
-		"PPPPPPPP"
-		"........"
-		"....p..."
-		"........"
-		"........"
-		"........"
-		"....k..."
-	);
-
-	theBoard.SwitchTurn();
-	DoMove(ParseMove("F7F5"));
-	theBoard.SwitchTurn();
-	ASSERT(IsMoveValid(theBoard, ParseMove("E5F6")));
-	auto hash = theBoard.GetHash();
-	DoMove(ParseMove("E5F6"));
-	UndoMove();
-	ASSERT(hash == theBoard.GetHash());
-
-
-
-
-}
-
-void Test() {
-	TestCastling();
-	TestMate();
-	TestEnPassant();
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <iostream>
+#include <thread>
+
+#include "Match.h"
+#include "MoveGenerator.h"
+#include "PgnBook.h"
+#include "Search.h"
+#include "Tablebase.h"
+#include "TranspositionTable.h"
+
+
+#define ASSERT(x) AssertImpl(x, #x)
+
+auto AssertImpl(bool condition, std::string check) {
+	if (condition) return;
+	std::cout << "Assertion " << check << " failed\n";
+}
+
+
+void TestCastling() {
+	std::cout << "TestCastling\n";
+	
+	Board board;
+	ParseBoard(board,
+		"...K...."
+		"........"
+		"........"
+		"........"
+		"........"
+		"........"
+		"........"
+		"....k..r"
+	);
+	ASSERT(IsMoveValid(board, ParseMove("E1G1")));
+
+	// Cannot castle when in check
+	ParseBoard(board,
+		"...KQ..."
+		"........"
+		"........"
+		"........"
+		"........"
+		"........"
+		"........"
+		"....k..r"
+	);
+	ASSERT(!IsMoveValid(board, ParseMove("E1G1")));
+	
+	ParseBoard(board,
+		"...K.Q.."
+		"........"
+		"........"
+		"........"
+		"........"
+		"........"
+		"........"
+		"....k..r"
+	);
+	ASSERT(!IsMoveValid(board, ParseMove("E1G1")));
+	
+	ParseBoard(board,
+		"...K..Q."
+		"........"
+		"........"
+		"........"
+		"........"
+		"........"
+		"........"
+		"....k..r"
+	);
+	ASSERT(!IsMoveValid(board, ParseMove("E1G1")));
+
+	ParseBoard(board,
+		"...K...."
+		"........"
+		"........"
+		"........"
+		"........"
+		"........"
+		"........"
+		"r...k..r"
+	);
+	ASSERT(IsMoveValid(board, ParseMove("E1C1")));
+
+	ParseBoard(board,
+		"...KQ..."
+		"........"
+		"........"
+		"........"
+		"........"
+		"........"
+		"........"
+		"r...k..r"
+	);
+	ASSERT(!IsMoveValid(board, ParseMove("E1C1")));
+
+	ParseBoard(board,
+		"...Q...K"
+		"........"
+		"........"
+		"........"
+		"........"
+		"........"
+		"........"
+		"r...k..r"
+	);
+	ASSERT(!IsMoveValid(board, ParseMove("E1C1")));
+
+	ParseBoard(board,
+		"..Q....K"
+		"........"
+		"........"
+		"........"
+		"........"
+		"........"
+		"........"
+		"r...k..r"
+	);
+	ASSERT(!IsMoveValid(board, ParseMove("E1C1")));
+
+	ParseBoard(board,
+		".Q.....K"
+		"........"
+		"........"
+		"........"
+		"........"
+		"........"
+		"........"
+		"r...k..r"
+	);
+	ASSERT(IsMoveValid(board, ParseMove("E1C1")));
+
+	ParseBoard(board,
+		"Q......K"
+		".P......"
+		"........"
+		"........"
+		"........"
+		"........"
+		"........"
+		"r...k..r"
+	);
+	ASSERT(IsMoveValid(board, ParseMove("E1C1")));
+
+	// Test castling rights
+	ParseBoard(theBoard,
+		".......K"
+		"........"
+		"........"
+		"........"
+		"........"
+		"........"
+		"........"
+		"r...k..r"
+	);
+
+	ASSERT(IsMoveValid(theBoard, ParseMove("E1G1")));
+	ASSERT(theBoard.HasCastlingRights(CastlingSide::KING));
+	ASSERT(IsMoveValid(theBoard, ParseMove("H1H2")));
+	DoMove(ParseMove("H1H2"));
+	ASSERT(!theBoard.HasCastlingRights(CastlingSide::KING));
+	theBoard.SwitchTurn();
+	DoMove(ParseMove("H8H7"));
+	theBoard.SwitchTurn();
+	DoMove(ParseMove("H2H1"));
+	theBoard.SwitchTurn();
+	ASSERT(!IsMoveValid(theBoard, ParseMove("E1G1")));
+
+	ParseBoard(theBoard,
+		".......K"
+		"........"
+		"........"
+		"........"
+		"........"
+		"........"
+		"........"
+		"r...k..r"
+	);
+	ASSERT(IsMoveValid(theBoard, ParseMove("E1G1")));
+	DoMove(ParseMove("E1F1"));
+	theBoard.SwitchTurn();
+	DoMove(ParseMove("H8G8"));
+	theBoard.SwitchTurn();
+	DoMove(ParseMove("F1E1"));
+	theBoard.SwitchTurn();
+	DoMove(ParseMove("G8H8"));
+	ASSERT(!IsMoveValid(theBoard, ParseMove("E1G1")));
+}
+
+
+void TestMate() {
+	ParseBoard(theBoard,
+		"........"
+		"........"
+		"........"
+		"........"
+		"........"
+		"....K..."
+		"....Q..."
+		"r...k..r"
+	);
+	ASSERT(IsInMate());
+
+	// Stalemate
+	ParseFENBoard(theBoard, "k7/2Q5/1K6/8/8/8/8/8 b - - 0 1");
+	ASSERT(!IsInMate());
+
+	// Back rank mate with either rook
+	ParseFENBoard(theBoard, "6k1/5ppp/8/8/8/8/q4PPP/1R1R2K1 w - - 0 1");
+	ClearHistory();
+	SearchLimits limits;
+	limits.depth = 4;
+	auto move = SearchBestMove(limits);
+	ASSERT(move == ParseMove("B1B8") || move == ParseMove("D1D8"));
+
+	// Nothing to play when stalemated
+	ParseFENBoard(theBoard, "7k/5Q2/6K1/8/8/8/8/8 b - - 0 1");
+	ClearHistory();
+	ASSERT(SearchBestMove(limits) == INVALID_MOVE);
+	ASSERT(GetLastSearchResult().pv.empty());
+}
+
+void TestTimeManager() {
+	// Out of time on the own clock, a budget of 0 would search until stopped
+	ParseFENBoard(theBoard, "rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq - 0 1");
+	ClearHistory();
+	SearchLimits limits;
+	limits.whiteTime = 60000;
+	auto start = std::chrono::steady_clock::now();
+	ASSERT(SearchBestMove(limits) != INVALID_MOVE);
+	ASSERT(std::chrono::steady_clock::now() - start < std::chrono::seconds(1));
+}
+
+void TestEnPassant() {
+	ParseBoard(theBoard,
+		"....K..."
+		"PPPPPPPP"
+		"........"
+		"....p..."
+		"........"
+		"........"
+		"........"
+		"....k..."
+	);
+
+	theBoard.SwitchTurn();
+	DoMove(ParseMove("F7F5"));
+	theBoard.SwitchTurn();
+	ASSERT(IsMoveValid(theBoard, ParseMove("E5F6")));
+	auto hash = theBoard.GetHash();
+	DoMove(ParseMove("E5F6"));
+	UndoMove();
+	ASSERT(hash == theBoard.GetHash());
+
+
+
+
+}
+
+void TestSAN() {
+	SetDefaultBoard(theBoard);
+	for (auto san : { "e4", "e5", "Nf3", "Nc6", "Bc4", "Bc5" }) {
+		auto move = ParseSANMove(san);
+		ASSERT(move != INVALID_MOVE);
+		DoMove(move);
+		theBoard.SwitchTurn();
+	}
+	ASSERT(ParseSANMove("O-O") == ParseMove("E1G1"));
+	ASSERT(ParseSANMove("Bxf7+") == ParseMove("C4F7"));
+	ASSERT(ParseSANMove("Ke3") == INVALID_MOVE);
+
+	ParseBoard(theBoard,
+		"....K..."
+		"........"
+		"........"
+		"........"
+		"........"
+		"........"
+		"....k..."
+		"r......r"
+	);
+	ASSERT(ParseSANMove("Rd1") == INVALID_MOVE);
+	ASSERT(ParseSANMove("Rad1") == ParseMove("A1D1"));
+	ASSERT(ParseSANMove("Rhd1") == ParseMove("H1D1"));
+
+	ParseFENBoard(theBoard, "8/4P3/8/8/8/8/k7/7K w - - 0 1");
+	ASSERT(ParseSANMove("e8=Q+") == ParseMove("E7E8"));
+	ASSERT(ParseSANMove("e8Q") == ParseMove("E7E8"));
+	ASSERT(ParseSANMove("e8=N") == INVALID_MOVE);
+	ASSERT(ParseSANMove("e8R") == INVALID_MOVE);
+}
+
+void TestDrawByRule() {
+	SetDefaultBoard(theBoard);
+	ClearHistory();
+	auto play = [](const char* move) {
+		DoMove(ParseMove(move));
+		theBoard.SwitchTurn();
+	};
+	for (auto move : { "G1F3", "G8F6", "F3G1", "F6G8" }) play(move);
+	// Repeated once, only a draw when the earlier position is part of the search
+	ASSERT(!IsDrawByRule(0));
+	ASSERT(IsDrawByRule(5));
+	for (auto move : { "G1F3", "G8F6", "F3G1", "F6G8" }) play(move);
+	ASSERT(IsDrawByRule(0));
+	play("E2E4");
+	ASSERT(!IsDrawByRule(5));
+	for (int i = 0; i < 9; i++) {
+		theBoard.SwitchTurn();
+		UndoMove();
+	}
+	ASSERT(theBoard.GetHalfmoveClock() == 0);
+
+	ParseFENBoard(theBoard, "8/8/8/4k3/8/8/8/R3K3 w Q - 99 80");
+	ClearHistory();
+	ASSERT(!IsDrawByRule(0));
+	auto hash = theBoard.GetHash();
+	play("A1A2");
+	ASSERT(IsDrawByRule(1));
+	theBoard.SwitchTurn();
+	UndoMove();
+	ASSERT(theBoard.GetHalfmoveClock() == 99);
+	// Losing the castling rights is undone in the hash as well
+	ASSERT(theBoard.GetHash() == hash);
+
+	// The king move into check that reaches the fifty move rule is illegal, not a draw
+	ParseFENBoard(theBoard, "7k/8/6K1/8/8/8/8/1Q6 w - - 98 1");
+	ClearHistory();
+	SearchLimits limits;
+	limits.depth = 4;
+	ASSERT(SearchBestMove(limits) == ParseMove("B1B8"));
+	ASSERT(GetLastSearchResult().score > MATE_THRESHOLD);
+}
+
+void TestTablebase() {
+	auto directory = (std::filesystem::temp_directory_path() / "ChessTablebaseTest").string();
+	ASSERT(GenerateTablebases({ "KQvK" }, directory, 1));
+
+	Board board;
+	int score;
+	ParseFENBoard(board, "k7/8/1K6/8/8/8/8/6Q1 w - - 0 1");
+	ASSERT(ProbeTablebase(board, score) && score == MAX_SCORE - 1);
+	ParseFENBoard(board, "7k/8/8/8/8/8/8/K5Q1 b - - 0 1");
+	ASSERT(ProbeTablebase(board, score) && score < -MATE_THRESHOLD);
+	// The queen is lost
+	ParseFENBoard(board, "8/8/8/8/8/8/2k5/K1Q5 b - - 0 1");
+	ASSERT(ProbeTablebase(board, score) && score == 0);
+
+	ParseFENBoard(theBoard, "k7/8/1K6/8/8/8/8/6Q1 w - - 0 1");
+	ASSERT(ProbeTablebaseRoot(score) == ParseMove("G1G8") && score == MAX_SCORE - 1);
+	std::filesystem::remove_all(directory);
+}
+
+void TestLegalMoves() {
+	Board board;
+	SetDefaultBoard(board);
+	MoveList moves;
+	GenerateLegalMoves(board, moves);
+	ASSERT(moves.GetNumMoves() == 20);
+
+	// Capturing en passant would expose the king to the rook, the board is not theBoard
+	SetDefaultBoard(theBoard);
+	ParseFENBoard(board, "4k3/8/8/KPp4r/8/8/8/8 w - c6 0 1");
+	ASSERT(!IsMoveValid(board, ParseMove("B5C6")));
+	ASSERT(!IsMoveValid(board, ParseMove("A5B4")));
+	ASSERT(IsMoveValid(board, ParseMove("B5B6")));
+	GenerateLegalMoves(board, moves);
+	ASSERT(moves.GetNumMoves() == 4);
+	// Served from the cache
+	GenerateLegalMoves(board, moves);
+	ASSERT(moves.GetNumMoves() == 4);
+}
+
+void TestSaveTranspositionTable() {
+	auto fileName = (std::filesystem::temp_directory_path() / "ChessHashTest.bin").string();
+	ResizeTranspositionTable(1);
+	*GetEntry(12345) = { 12345, Bound::EXACT, 7, 42, ParseMove("E2E4") };
+	ASSERT(SaveTranspositionTable(fileName));
+
+	ClearTranspositionTable();
+	ASSERT(GetEntry(12345)->hash == 0);
+	ASSERT(LoadTranspositionTable(fileName));
+	auto entry = GetEntry(12345);
+	ASSERT(entry->hash == 12345 && entry->depth == 7 && entry->score == 42 && entry->bestMove == ParseMove("E2E4"));
+	// Writes go to memory only
+	entry->depth = 8;
+	ClearTranspositionTable();
+	ASSERT(LoadTranspositionTable(fileName) && GetEntry(12345)->depth == 7);
+
+	// A truncated file is rejected and the table is kept
+	auto truncatedFileName = fileName + ".truncated";
+	std::filesystem::copy_file(fileName, truncatedFileName, std::filesystem::copy_options::overwrite_existing);
+	std::filesystem::resize_file(truncatedFileName, 100);
+	ASSERT(!LoadTranspositionTable(truncatedFileName));
+	ASSERT(GetEntry(12345)->depth == 7);
+
+	// A worker with a table of its own neither sees nor changes the shared one
+	std::thread worker([]() {
+		UseThreadTranspositionTable(1);
+		ASSERT(GetEntry(12345)->hash == 0);
+		GetEntry(12345)->depth = 9;
+		ClearTranspositionTable();
+	});
+	worker.join();
+	ASSERT(GetEntry(12345)->depth == 7);
+
+	ResizeTranspositionTable(DEFAULT_HASH_SIZE);
+	std::filesystem::remove(fileName);
+	std::filesystem::remove(truncatedFileName);
+}
+
+void TestMatchStatistics() {
+	ASSERT(ComputeElo(10, 5, 10).elo == 0);
+	auto elo = ComputeElo(75, 0, 25);
+	ASSERT(elo.elo > 190 && elo.elo < 191);
+	ASSERT(elo.margin > 0 && elo.margin < ComputeElo(15, 0, 5).margin);
+	ASSERT(ComputeSprtLLR(60, 20, 20, 0, 5) > 0);
+	ASSERT(ComputeSprtLLR(20, 20, 60, 0, 5) < 0);
+	// An even score is closer to elo0
+	ASSERT(ComputeSprtLLR(30, 40, 30, 0, 5) < 0);
+	// Without losses the test still stops early, past the upper bound of alpha = beta = 0.05
+	ASSERT(ComputeSprtLLR(100, 100, 0, 0, 5) > std::log(19));
+	ASSERT(ComputeSprtLLR(0, 100, 100, 0, 5) < -std::log(19));
+}
+
+void TestPieceEncoding() {
+	for (auto piece : { Piece::WHITE_PAWN, Piece::WHITE_ROOK, Piece::WHITE_KNIGHT, Piece::WHITE_BISHOP, Piece::WHITE_QUEEN, Piece::WHITE_KING }) {
+		auto black = InvertPiece(piece);
+		ASSERT(GetColorOfPiece(piece) == Color::WHITE);
+		ASSERT(GetColorOfPiece(black) == Color::BLACK);
+		ASSERT(GetPieceType(black) == GetPieceType(piece));
+		ASSERT(InvertPiece(black) == piece);
+	}
+	ASSERT(InvertPiece(Piece::WHITE_KING) == Piece::BLACK_KING);
+	ASSERT(InvertPiece(Piece::NO_PIECE) == Piece::NO_PIECE);
+	ASSERT(GetColorOfPiece(Piece::NO_PIECE) == Color::NEUTRAL);
+	ASSERT(GetPieceType(Piece::BLACK_QUEEN) == PieceType::QUEEN);
+}
+
+void Test() {
+	TestCastling();
+	TestMate();
+	TestTimeManager();
+	TestEnPassant();
+	TestSAN();
+	TestDrawByRule();
+	TestTablebase();
+	TestLegalMoves();
+	TestSaveTranspositionTable();
+	TestMatchStatistics();
+	TestPieceEncoding();
 }
\ No newline at end of file
@@ -0,0 +1,105 @@
+#include <algorithm>
+
+#include "TimeManager.h"
+
+void TimeManager::Start(const SearchLimits& limits, Color turn) {
+    this->limits = limits;
+    this->turn = turn;
+    pondering = limits.ponder;
+    startTime = std::chrono::steady_clock::now();
+    softLimit = 0;
+    hardLimit = 0;
+    lastIterationEnd = 0;
+    previousIterationTime = 0;
+    lastBestMove = INVALID_MOVE;
+    lastScore = 0;
+    stableIterations = 0;
+
+    if (!pondering) ComputeBudget();
+}
+
+void TimeManager::PonderHit() {
+    pondering = false;
+    startTime = std::chrono::steady_clock::now();
+    lastIterationEnd = 0;
+    ComputeBudget();
+}
+
+void TimeManager::ComputeBudget() {
+    if (limits.infinite) return;
+
+    if (limits.moveTime > 0) {
+        softLimit = std::max(1, limits.moveTime - MOVE_OVERHEAD);
+        hardLimit = softLimit;
+        return;
+    }
+
+    auto time = turn == Color::WHITE ? limits.whiteTime : limits.blackTime;
+    auto increment = turn == Color::WHITE ? limits.whiteIncrement : limits.blackIncrement;
+    // No clock at all, the search is bounded by depth or nodes
+    if (!limits.whiteTime && !limits.blackTime && !limits.whiteIncrement && !limits.blackIncrement) return;
+    // Out of time, 0 would mean no limit, so move almost at once
+    if (time <= 0) {
+        softLimit = std::max(1, increment / 2);
+        hardLimit = softLimit;
+        return;
+    }
+
+    int64_t available = std::max(1, time - MOVE_OVERHEAD);
+    int64_t movesToGo = limits.movesToGo > 0 ? std::min(limits.movesToGo, 40) : 30;
+
+    softLimit = available / movesToGo + increment * 3 / 4;
+    // Never use more than a fraction of the clock on one move, unless it is the last one before the time control
+    auto maximum = movesToGo == 1 ? available : available * 3 / 4;
+    hardLimit = std::min(softLimit * 4, maximum);
+    softLimit = std::min(softLimit, hardLimit);
+}
+
+auto TimeManager::GetElapsed() const -> int64_t {
+    auto now = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::milliseconds>(now - startTime).count();
+}
+
+auto TimeManager::IsHardLimitReached(uint64_t nodes) const -> bool {
+    if (pondering || limits.infinite) return false;
+    if (limits.nodes > 0 && nodes >= limits.nodes) return true;
+    return hardLimit > 0 && GetElapsed() >= hardLimit;
+}
+
+auto TimeManager::ShouldStartIteration(int depth, Move bestMove, int score) -> bool {
+    auto elapsed = GetElapsed();
+    auto iterationTime = elapsed - lastIterationEnd;
+    lastIterationEnd = elapsed;
+
+    if (bestMove == lastBestMove) {
+        stableIterations++;
+    }
+    else {
+        stableIterations = 0;
+    }
+    auto scoreDrop = lastScore - score;
+    lastBestMove = bestMove;
+    lastScore = score;
+
+    if (pondering || limits.infinite) return true;
+    if (limits.depth > 0 && depth >= limits.depth) return false;
+    if (softLimit == 0) return true;
+
+    // Spend less time when the best move keeps coming back, more when the score is dropping
+    double factor = 1.0;
+    if (stableIterations >= 4) factor = 0.5;
+    else if (stableIterations >= 2) factor = 0.75;
+    if (depth > 4 && scoreDrop > 80) factor *= 2.0;
+    else if (depth > 4 && scoreDrop > 30) factor *= 1.5;
+
+    auto limit = std::min(static_cast<int64_t>(softLimit * factor), hardLimit);
+    if (elapsed >= limit) return false;
+
+    // Estimate the cost of the next iteration from the growth of the previous ones, do not start it when
+    // it would be aborted anyway
+    auto growth = std::clamp(static_cast<double>(iterationTime) / std::max<int64_t>(previousIterationTime, 1), 2.0, 16.0);
+    previousIterationTime = iterationTime;
+    if (elapsed + static_cast<int64_t>(iterationTime * growth) > hardLimit) return false;
+
+    return true;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+#include "Board.h"
+#include "Move.h"
+
+constexpr int DEFAULT_MOVE_TIME = 1000;
+constexpr int MOVE_OVERHEAD = 30;
+
+// Limits as given by the UCI go command, all times in milliseconds, 0 means not set
+struct SearchLimits {
+    int whiteTime = 0;
+    int blackTime = 0;
+    int whiteIncrement = 0;
+    int blackIncrement = 0;
+    int movesToGo = 0;
+    int moveTime = 0;
+    int depth = 0;
+    uint64_t nodes = 0;
+    bool infinite = false;
+    bool ponder = false;
+    // Number of best root moves that are searched and reported, each with its own line
+    int multiPV = 1;
+
+    auto HasLimits() const -> bool {
+        return whiteTime || blackTime || moveTime || depth || nodes || infinite;
+    }
+};
+
+class TimeManager {
+public:
+    void Start(const SearchLimits& limits, Color turn);
+
+    // Starts the clock for a search that was pondering until now
+    void PonderHit();
+
+    auto IsPondering() const -> bool {
+        return pondering;
+    }
+
+    auto GetElapsed() const -> int64_t;
+
+    // Checked from within the search, the search is aborted when this returns true
+    auto IsHardLimitReached(uint64_t nodes) const -> bool;
+
+    // Checked after every completed iteration
+    auto ShouldStartIteration(int depth, Move bestMove, int score) -> bool;
+
+private:
+    void ComputeBudget();
+
+    SearchLimits limits;
+    Color turn = Color::WHITE;
+    bool pondering = false;
+    std::chrono::steady_clock::time_point startTime;
+    int64_t softLimit = 0;
+    int64_t hardLimit = 0;
+    int64_t lastIterationEnd = 0;
+    int64_t previousIterationTime = 0;
+    Move lastBestMove = INVALID_MOVE;
+    int lastScore = 0;
+    int stableIterations = 0;
+};
@@ -1,19 +1,155 @@
-#include <vector>
-
-#include "TranspositionTable.h"
-
-
-std::vector<TtEntry> transpositionTable;
-
-auto InitializeTranspositionTable() -> bool {
-	int numEntries = 512 * 1024 * 1024 / sizeof(TtEntry);
-	transpositionTable.resize(numEntries);
-	return true;
-}
-
-bool transpositionTableInitialed = InitializeTranspositionTable();
-
-
-auto GetEntry(uint64_t hash) -> TtEntry* {
-	return &transpositionTable[hash % transpositionTable.size()];
-}
\ No newline at end of file
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+#include "MappedFile.h"
+#include "TranspositionTable.h"
+#include "Zobrist.h"
+
+namespace {
+	// Saved table: a header followed by the entries exactly as they are in memory, so the file can be mapped as table
+	constexpr char TT_MAGIC[8] = { 'C', 'H', 'E', 'S', 'S', 'T', 'T', '1' };
+
+	struct TtFileHeader {
+		char magic[8];
+		uint32_t zobristVersion;
+		uint32_t entrySize;
+		uint64_t numEntries;
+		// Keeps the entries aligned to cache lines
+		uint8_t padding[40];
+	};
+
+	static_assert(sizeof(TtFileHeader) == 64);
+
+	std::vector<TtEntry> ownedTable;
+	// A loaded table is a private mapping of its file, pages are read when first probed
+	MappedFile mappedTable;
+
+	thread_local std::vector<TtEntry> threadTable;
+}
+
+TtEntry* transpositionTable = nullptr;
+size_t transpositionTableSize = 0;
+// Kept apart from threadTable, so GetEntry does not need a guarded thread_local
+thread_local TtEntry* threadTableEntries = nullptr;
+thread_local size_t threadTableSize = 0;
+
+void ResizeTranspositionTable(int megabytes) {
+	auto numEntries = static_cast<size_t>(megabytes) * 1024 * 1024 / sizeof(TtEntry);
+	// Release the old table first, both might not fit in memory at the same time
+	mappedTable.Close();
+	std::vector<TtEntry>().swap(ownedTable);
+	ownedTable.resize(std::max<size_t>(numEntries, 1));
+	transpositionTable = ownedTable.data();
+	transpositionTableSize = ownedTable.size();
+}
+
+void ClearTranspositionTable() {
+	if (threadTableEntries) {
+		std::fill(threadTable.begin(), threadTable.end(), TtEntry{});
+		return;
+	}
+	if (mappedTable.IsOpen()) {
+		// Writing every page of the mapping would copy all of them, a fresh table is cheaper
+		auto numEntries = transpositionTableSize;
+		mappedTable.Close();
+		ownedTable.resize(numEntries);
+		transpositionTable = ownedTable.data();
+		return;
+	}
+	std::fill(ownedTable.begin(), ownedTable.end(), TtEntry{});
+}
+
+auto GetTranspositionTableMegabytes() -> int {
+	// Rounded, the entries do not fill the megabytes they were sized from exactly
+	return static_cast<int>((transpositionTableSize * sizeof(TtEntry) + 512 * 1024) / (1024 * 1024));
+}
+
+void UseThreadTranspositionTable(int megabytes) {
+	auto numEntries = static_cast<size_t>(megabytes) * 1024 * 1024 / sizeof(TtEntry);
+	std::vector<TtEntry>().swap(threadTable);
+	threadTable.resize(std::max<size_t>(numEntries, 1));
+	threadTableEntries = threadTable.data();
+	threadTableSize = threadTable.size();
+}
+
+auto SaveTranspositionTable(const std::string& fileName) -> bool {
+	TtFileHeader header = {};
+	std::memcpy(header.magic, TT_MAGIC, sizeof(TT_MAGIC));
+	header.zobristVersion = ZOBRIST_VERSION;
+	header.entrySize = sizeof(TtEntry);
+	header.numEntries = transpositionTableSize;
+
+	// Written next to the target and renamed, the file might be mapped as the current table
+	auto tempFile = fileName + ".tmp";
+	{
+		std::ofstream os(tempFile, std::ios::binary | std::ios::trunc);
+		os.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		os.write(reinterpret_cast<const char*>(transpositionTable), transpositionTableSize * sizeof(TtEntry));
+		if (!os) {
+			std::cerr << "Cannot write " << tempFile << "\n";
+			return false;
+		}
+	}
+	std::error_code error;
+	std::filesystem::rename(tempFile, fileName, error);
+	if (error) {
+		std::cerr << "Cannot write " << fileName << "\n";
+		return false;
+	}
+	return true;
+}
+
+auto LoadTranspositionTable(const std::string& fileName) -> bool {
+	// The header is checked before the current table is given up
+	TtFileHeader header;
+	std::ifstream is(fileName, std::ios::binary);
+	if (!is.read(reinterpret_cast<char*>(&header), sizeof(header))) return false;
+	std::error_code error;
+	auto fileSize = std::filesystem::file_size(fileName, error);
+	if (error
+		|| std::memcmp(header.magic, TT_MAGIC, sizeof(TT_MAGIC)) != 0
+		|| header.zobristVersion != ZOBRIST_VERSION
+		|| header.entrySize != sizeof(TtEntry)
+		|| header.numEntries == 0
+		|| fileSize != sizeof(TtFileHeader) + header.numEntries * sizeof(TtEntry)) {
+		return false;
+	}
+
+	// Mapped before the current table is given up as well, mapping only reserves address space until pages are read
+	MappedFile loaded;
+	if (!loaded.Open(fileName, true) || loaded.GetSize() != fileSize) return false;
+	mappedTable = std::move(loaded);
+	std::vector<TtEntry>().swap(ownedTable);
+	transpositionTable = reinterpret_cast<TtEntry*>(mappedTable.GetMutableData() + sizeof(TtFileHeader));
+	transpositionTableSize = static_cast<size_t>(header.numEntries);
+	return true;
+}
+
+auto InitializeTranspositionTable() -> bool {
+	ResizeTranspositionTable(DEFAULT_HASH_SIZE);
+	return true;
+}
+
+bool transpositionTableInitialed = InitializeTranspositionTable();
+
+
+auto GetEntry(uint64_t hash) -> TtEntry* {
+	if (threadTableEntries) return &threadTableEntries[hash % threadTableSize];
+	return &transpositionTable[hash % transpositionTableSize];
+}
+
+auto GetHashFull() -> int {
+	auto table = threadTableEntries ? threadTableEntries : transpositionTable;
+	auto size = threadTableEntries ? threadTableSize : transpositionTableSize;
+	// Permille of used entries, estimated from a sample at the start of the table
+	auto sampleSize = std::min<size_t>(1000, size);
+	int used = 0;
+	for (size_t i = 0; i < sampleSize; i++) {
+		if (table[i].hash != 0) used++;
+	}
+	return static_cast<int>(used * 1000 / sampleSize);
+}
@@ -1,21 +1,39 @@
-#pragma once
-
-#include <cstdint>
-
-#include "Move.h"
-
-enum class Bound {
-	EXACT,
-	LOWER_BOUND,
-	UPPER_BOUND
-};
-
-struct TtEntry {
-	uint64_t hash = 0;
-	Bound bound;
-	int depth = 0;
-	int score = 0;
-	Move bestMove = INVALID_MOVE;
-};
-
-auto GetEntry(uint64_t hash) -> TtEntry*;
\ No newline at end of file
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "Move.h"
+
+constexpr int DEFAULT_HASH_SIZE = 512;
+
+enum class Bound {
+	EXACT,
+	LOWER_BOUND,
+	UPPER_BOUND
+};
+
+struct TtEntry {
+	uint64_t hash = 0;
+	Bound bound;
+	int depth = 0;
+	int score = 0;
+	Move bestMove = INVALID_MOVE;
+};
+
+void ResizeTranspositionTable(int megabytes);
+void ClearTranspositionTable();
+// Writes the table with a header that identifies the Zobrist keys and the entry layout
+auto SaveTranspositionTable(const std::string& fileName) -> bool;
+// Replaces the table by a saved one, which takes the size of the file. The file is mapped and pages are read
+// on first use, writes stay in memory. Fails for files of other keys or layouts or that cannot be mapped, and keeps
+// the current table.
+// The file must not be changed in place while loaded, SaveTranspositionTable replaces it instead.
+auto LoadTranspositionTable(const std::string& fileName) -> bool;
+auto GetTranspositionTableMegabytes() -> int;
+// Gives the calling thread a table of its own for as long as it lives, for workers that search side by side and
+// would otherwise write the shared table at the same time. GetEntry, GetHashFull and ClearTranspositionTable then
+// use it, the other functions keep working on the shared table.
+void UseThreadTranspositionTable(int megabytes);
+auto GetEntry(uint64_t hash) -> TtEntry*;
+auto GetHashFull() -> int;
\ No newline at end of file
@@ -1,93 +1,551 @@
-#include <iostream>
-#include <sstream>
-#include <string>
-#include <vector>
-
-#include "Board.h"
-#include "Move.h"
-#include "MoveGenerator.h"
-#include "Search.h"
-
-void UCILoop() {
-	while (true) {
-		std::string line;
-		std::getline(std::cin, line);
-
-		std::vector<std::string> arguments;
-		std::string arg;
-		std::istringstream iss(line);
-
-		while (iss >> arg) {
-			arguments.push_back(arg);
-		}
-
-		if (arguments.empty()) break;
-
-		std::string command = arguments[0];
-
-		if (command == "uci") {
-			std::cout << "info name JChess\n";
-			std::cout << "info author Jasper Smit\n";
-			std::cout << "uciok\n";
-		} else if (command == "isready") {
-			std::cout << "readyok\n";
-		}
-		else if (command == "ucinewgame") {
-			// Do nothing
-		}
-		else if (command == "position") {
-			if (arguments.size() >= 2 && arguments[1] == "startpos") {
-				SetDefaultBoard(theBoard);
-			}
-			if (arguments.size() >= 3 && arguments[2] == "moves") {
-				for (int i = 3; i < arguments.size(); i++) {
-					auto move = ParseMove(arguments[i]);
-					if (!IsMoveValid(theBoard, move)) {
-						std::cout << "Invalid move\n";
-						move = INVALID_MOVE;
-					}
-					else {
-						DoMove(move);
-						theBoard.SwitchTurn();
-					}
-				}
-			}
-		}
-		else if (command == "move?") { // Unofficial, tries to make a move replied with valid or invalid
-			SetDefaultBoard(theBoard);
-			bool valid = true;
-			for (int i = 1; i < arguments.size(); i++) {
-				auto move = ParseMove(arguments[i]);
-				if (!IsMoveValid(theBoard, move)) {
-					valid = false;
-				}
-				else {
-					DoMove(move);
-					theBoard.SwitchTurn();
-				}
-			}
-			std::cout << (valid ? "valid\n" : "invalid\n");
-
-		}
-		else if (command == "go") {
-			auto move = FindBestMoveInTime();
-			DoMove(move);
-			theBoard.SwitchTurn();
-			std::cout << "bestmove " << MoveToUCI(move);
-			if (IsInMate()) {
-				std::cout << " mate";
-			}
-			std::cout << "\n";
-		}
-		else if (command == "getboard") {
-			std::cout << "board " << GetProtocolString(theBoard) << "\n";
-		}
-		else if (command == "exit") {
-			break;
-		}
-		else {
-			std::cout << "unknown command " << command << "\n";
-			break;
-		}
-	}
-}
\ No newline at end of file
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "Bench.h"
+#include "Board.h"
+#include "Move.h"
+#include "MoveGenerator.h"
+#include "Search.h"
+#include "SearchStats.h"
+#include "TimeManager.h"
+#include "TranspositionTable.h"
+
+namespace {
+	class CommandQueue {
+	public:
+		void Push(std::string command) {
+			{
+				std::lock_guard lock(mutex);
+				commands.push_back(std::move(command));
+			}
+			condition.notify_one();
+		}
+
+		auto Pop() -> std::string {
+			std::unique_lock lock(mutex);
+			condition.wait(lock, [this]() { return !commands.empty(); });
+			auto command = std::move(commands.front());
+			commands.pop_front();
+			return command;
+		}
+
+	private:
+		std::mutex mutex;
+		std::condition_variable condition;
+		std::deque<std::string> commands;
+	};
+
+	std::mutex outputMutex;
+
+	// Output is written from both the command loop and the search thread
+	void Send(const std::string& line) {
+		std::lock_guard lock(outputMutex);
+		std::cout << line << std::endl;
+	}
+
+	void ReadInput(CommandQueue& queue, SearchThread& searchThread) {
+		std::string line;
+		while (std::getline(std::cin, line)) {
+			// Stop the search right away, the command loop might still be busy with earlier commands
+			if (line == "stop" || line == "quit" || line == "exit") {
+				searchThread.Stop();
+			}
+			// Likewise the clock of a ponder search starts as soon as possible
+			if (line == "ponderhit") {
+				searchThread.PonderHit();
+			}
+			queue.Push(line);
+		}
+		searchThread.Stop();
+		queue.Push("quit");
+	}
+
+	auto ParseSearchLimits(const std::vector<std::string>& arguments) -> SearchLimits {
+		SearchLimits limits;
+		for (int i = 1; i + 1 < arguments.size(); i++) {
+			auto& name = arguments[i];
+			auto& value = arguments[i + 1];
+			if (name == "wtime") limits.whiteTime = std::stoi(value);
+			else if (name == "btime") limits.blackTime = std::stoi(value);
+			else if (name == "winc") limits.whiteIncrement = std::stoi(value);
+			else if (name == "binc") limits.blackIncrement = std::stoi(value);
+			else if (name == "movestogo") limits.movesToGo = std::stoi(value);
+			else if (name == "movetime") limits.moveTime = std::stoi(value);
+			else if (name == "depth") limits.depth = std::stoi(value);
+			else if (name == "nodes") limits.nodes = std::stoull(value);
+			else continue;
+			i++;
+		}
+		for (auto& argument : arguments) {
+			if (argument == "infinite") limits.infinite = true;
+			if (argument == "ponder") limits.ponder = true;
+		}
+		if (!limits.HasLimits()) {
+			limits.moveTime = DEFAULT_MOVE_TIME;
+		}
+		return limits;
+	}
+
+	// Name and value of "setoption name <name> value <value>", names may contain spaces
+	auto ParseOption(const std::vector<std::string>& arguments) -> std::pair<std::string, std::string> {
+		std::string name;
+		std::string value;
+		auto* target = static_cast<std::string*>(nullptr);
+		for (int i = 1; i < arguments.size(); i++) {
+			if (arguments[i] == "name") target = &name;
+			else if (arguments[i] == "value") target = &value;
+			else if (target) *target += (target->empty() ? "" : " ") + arguments[i];
+		}
+		return { name, value };
+	}
+
+	auto JoinArguments(const std::vector<std::string>& arguments, size_t first) -> std::string {
+		std::string joined;
+		for (auto i = first; i < arguments.size(); i++) {
+			joined += (joined.empty() ? "" : " ") + arguments[i];
+		}
+		return joined;
+	}
+
+	// The position command that led to theBoard, so a command that only extends the game plays just the new moves
+	struct GameRecord {
+		// startpos, or fen followed by its fields, empty when the board is not known to match the moves
+		std::vector<std::string> start;
+		std::vector<Move> moves;
+	};
+
+	// Plays the moves from the given argument on, invalid moves are skipped and make it return false
+	auto PlayMoves(const std::vector<std::string>& arguments, size_t first, GameRecord& game) -> bool {
+		bool valid = true;
+		for (auto i = first; i < arguments.size(); i++) {
+			auto move = ParseMove(arguments[i]);
+			if (!IsMoveValid(theBoard, move)) {
+				valid = false;
+				game.start.clear();
+			}
+			else {
+				DoMove(move);
+				theBoard.SwitchTurn();
+				game.moves.push_back(move);
+			}
+		}
+		return valid;
+	}
+
+	// Sets theBoard to the start position followed by the moves from the given argument on
+	auto SetGame(const std::vector<std::string>& start, const std::vector<std::string>& arguments, size_t first, GameRecord& game) -> bool {
+		auto extends = !game.start.empty() && start == game.start && arguments.size() - first >= game.moves.size();
+		for (size_t i = 0; extends && i < game.moves.size(); i++) {
+			extends = ParseMove(arguments[first + i]) == game.moves[i];
+		}
+		if (extends) {
+			return PlayMoves(arguments, first + game.moves.size(), game);
+		}
+
+		game.start = start;
+		game.moves.clear();
+		if (start.size() == 1 && start[0] == "startpos") {
+			SetDefaultBoard(theBoard);
+			ClearHistory();
+		}
+		else if (start.size() >= 5 && start[0] == "fen") {
+			ParseFENBoard(theBoard, JoinArguments(start, 1));
+			ClearHistory();
+		}
+		else {
+			// The moves are played on whatever the board was
+			game.start.clear();
+		}
+		return PlayMoves(arguments, first, game);
+	}
+
+	// "position startpos|fen <fen> [moves <moves>]"
+	auto SetPosition(const std::vector<std::string>& arguments, GameRecord& game) -> bool {
+		auto moves = std::find(arguments.begin(), arguments.end(), "moves");
+		std::vector<std::string> start(arguments.begin() + std::min<size_t>(arguments.size(), 1), moves);
+		return SetGame(start, arguments, moves == arguments.end() ? arguments.size() : moves - arguments.begin() + 1, game);
+	}
+
+	// Reply to "legalmoves [fen <fen>]", the moves of the given position or else of theBoard
+	auto FormatLegalMoves(const std::vector<std::string>& arguments) -> std::string {
+		auto board = theBoard;
+		if (arguments.size() >= 6 && arguments[1] == "fen") {
+			ParseFENBoard(board, JoinArguments(arguments, 2));
+		}
+		MoveList moves;
+		GenerateLegalMoves(board, moves);
+		std::string reply = "legalmoves";
+		for (auto move : moves) {
+			reply += " " + MoveToUCI(move);
+		}
+		return reply;
+	}
+
+	// "bestmove <move>", followed by mate when the move mates or else by the expected reply to ponder on.
+	// Called on the thread that searched.
+	auto FormatBestMove(Move move) -> std::string {
+		std::string reply = "bestmove " + MoveToUCI(move);
+		DoMove(move);
+		theBoard.SwitchTurn();
+		auto& pv = GetLastSearchResult().pv;
+		if (IsInMate()) {
+			reply += " mate";
+		}
+		else if (pv.size() >= 2 && pv[0] == move && IsMoveValid(theBoard, pv[1])) {
+			reply += " ponder " + MoveToUCI(pv[1]);
+		}
+		theBoard.SwitchTurn();
+		UndoMove();
+		return reply;
+	}
+
+	void SendStats(const SearchStats& stats, bool json) {
+		if (json) {
+			Send("info string stats " + stats.ToJson());
+			return;
+		}
+		for (auto& line : stats.ToLines()) {
+			Send("info string " + line);
+		}
+	}
+}
+
+void UCILoop() {
+	// Static, the input thread outlives this function because it is blocked on std::cin and cannot be joined
+	static CommandQueue queue;
+	static SearchThread searchThread(Send);
+	std::thread inputThread(ReadInput, std::ref(queue), std::ref(searchThread));
+	inputThread.detach();
+
+	// The move found by the last search, applied to the board once the command loop picks it up
+	std::mutex resultMutex;
+	std::optional<Move> playedMove;
+	GameRecord game;
+	bool debug = false;
+	int multiPV = 1;
+	int hashSize = DEFAULT_HASH_SIZE;
+
+	while (true) {
+		auto line = queue.Pop();
+
+		{
+			std::lock_guard lock(resultMutex);
+			if (playedMove) {
+				DoMove(*playedMove);
+				theBoard.SwitchTurn();
+				game.moves.push_back(*playedMove);
+				playedMove = {};
+			}
+		}
+
+		std::vector<std::string> arguments;
+		std::string arg;
+		std::istringstream iss(line);
+
+		while (iss >> arg) {
+			arguments.push_back(arg);
+		}
+
+		if (arguments.empty()) break;
+
+		std::string command = arguments[0];
+
+		if (command == "uci") {
+			Send("info name JChess");
+			Send("info author Jasper Smit");
+			Send("option name Hash type spin default " + std::to_string(DEFAULT_HASH_SIZE) + " min 1 max 65536");
+			Send("option name MultiPV type spin default 1 min 1 max " + std::to_string(MAX_MULTI_PV));
+			Send("option name Ponder type check default false");
+			Send("uciok");
+		} else if (command == "isready") {
+			Send("readyok");
+		}
+		else if (command == "ucinewgame") {
+			// Do nothing
+		}
+		else if (command == "setoption") {
+			auto [name, value] = ParseOption(arguments);
+			if (name == "Hash") {
+				searchThread.Stop();
+				searchThread.Wait();
+				hashSize = std::clamp(std::stoi(value), 1, 65536);
+				ResizeTranspositionTable(hashSize);
+			}
+			else if (name == "MultiPV") {
+				multiPV = std::clamp(std::stoi(value), 1, MAX_MULTI_PV);
+			}
+			else if (name == "Ponder") {
+				// Nothing to do, the GUI starts pondering with go ponder
+			}
+			else {
+				Send("info string unknown option " + name);
+			}
+		}
+		else if (command == "position") {
+			if (!SetPosition(arguments, game)) {
+				Send("Invalid move");
+			}
+		}
+		else if (command == "move?") { // Unofficial, tries to make a move replied with valid or invalid
+			Send(SetGame({ "startpos" }, arguments, 1, game) ? "valid" : "invalid");
+		}
+		else if (command == "legalmoves") { // Unofficial, legalmoves [fen <fen>] replied with legalmoves <moves>
+			Send(FormatLegalMoves(arguments));
+		}
+		else if (command == "go") {
+			auto limits = ParseSearchLimits(arguments);
+			limits.multiPV = multiPV;
+			searchThread.Go(theBoard, GetHashHistory(), limits, [&](Move move) {
+				// Runs on the search thread, which has its own copy of the board
+				if (debug) {
+					SendStats(searchStats, false);
+				}
+				// Mated or stalemated, there is no move to play
+				if (move == INVALID_MOVE) {
+					Send("bestmove 0000");
+					return;
+				}
+				auto reply = FormatBestMove(move);
+				{
+					std::lock_guard lock(resultMutex);
+					playedMove = move;
+				}
+				Send(reply);
+			});
+		}
+		else if (command == "stop") {
+			searchThread.Stop();
+		}
+		else if (command == "ponderhit") {
+			searchThread.PonderHit();
+		}
+		else if (command == "debug") {
+			debug = arguments.size() >= 2 && arguments[1] == "on";
+		}
+		else if (command == "stats") { // Unofficial, search statistics of all threads, stats json for a single JSON line
+			SendStats(GetMergedSearchStats(), arguments.size() >= 2 && arguments[1] == "json");
+		}
+		else if (command == "bench") { // Unofficial, bench [depth] [threads] [hash]
+			searchThread.Stop();
+			searchThread.Wait();
+			Bench(
+				arguments.size() >= 2 ? std::stoi(arguments[1]) : DEFAULT_BENCH_DEPTH,
+				arguments.size() >= 3 ? std::stoi(arguments[2]) : DEFAULT_BENCH_THREADS,
+				arguments.size() >= 4 ? std::stoi(arguments[3]) : DEFAULT_BENCH_HASH);
+			ResizeTranspositionTable(hashSize);
+			// The bench positions replaced the board
+			game = {};
+		}
+		else if (command == "getboard") {
+			Send("board " + GetProtocolString(theBoard));
+		}
+		else if (command == "savehash" && arguments.size() >= 2) { // Unofficial, savehash <file>
+			searchThread.Stop();
+			searchThread.Wait();
+			auto fileName = JoinArguments(arguments, 1);
+			Send(SaveTranspositionTable(fileName) ? "info string saved hash to " + fileName : "info string cannot save hash to " + fileName);
+		}
+		else if (command == "loadhash" && arguments.size() >= 2) { // Unofficial, loadhash <file>, the table takes the size of the file
+			searchThread.Stop();
+			searchThread.Wait();
+			auto fileName = JoinArguments(arguments, 1);
+			if (LoadTranspositionTable(fileName)) {
+				hashSize = std::max(1, GetTranspositionTableMegabytes());
+				Send("info string loaded hash of " + std::to_string(hashSize) + " MB from " + fileName);
+			}
+			else {
+				Send("info string cannot load hash from " + fileName);
+			}
+		}
+		else if (command == "quit" || command == "exit") {
+			break;
+		}
+		else {
+			Send("unknown command " + command);
+			break;
+		}
+	}
+	searchThread.Stop();
+	searchThread.Wait();
+}
+namespace {
+	// A game of the server, loaded into theBoard of the worker that runs its commands
+	struct Session {
+		Board board;
+		std::vector<uint64_t> hashHistory;
+		GameRecord game;
+		// Run in order, by one worker at a time
+		std::deque<std::string> commands;
+		bool scheduled = false;
+	};
+
+	class SessionServer {
+	public:
+		void Push(const std::string& id, std::string command) {
+			{
+				std::lock_guard lock(mutex);
+				auto [entry, created] = sessions.try_emplace(id);
+				auto& session = entry->second;
+				if (created) SetDefaultBoard(session.board);
+				session.commands.push_back(std::move(command));
+				if (session.scheduled) return;
+				session.scheduled = true;
+				ready.push_back(id);
+			}
+			condition.notify_one();
+		}
+
+		// The workers finish the queued commands before they return
+		void Quit() {
+			{
+				std::lock_guard lock(mutex);
+				quit = true;
+			}
+			condition.notify_all();
+		}
+
+		void Work() {
+			std::unique_lock lock(mutex);
+			while (true) {
+				condition.wait(lock, [this]() { return quit || !ready.empty(); });
+				if (ready.empty()) return;
+				auto id = std::move(ready.front());
+				ready.pop_front();
+				// References to map elements stay valid while other sessions are added
+				auto& session = sessions.at(id);
+				auto command = std::move(session.commands.front());
+				session.commands.pop_front();
+				lock.unlock();
+
+				auto closed = Run(id, session, command);
+
+				lock.lock();
+				if (!session.commands.empty()) {
+					// Back of the queue, so a busy session does not starve the others
+					ready.push_back(id);
+					condition.notify_one();
+				}
+				else if (closed) {
+					sessions.erase(id);
+				}
+				else {
+					session.scheduled = false;
+				}
+			}
+		}
+
+	private:
+		// Returns true when the session is closed
+		auto Run(const std::string& id, Session& session, const std::string& line) -> bool {
+			std::vector<std::string> arguments;
+			std::istringstream iss(line);
+			for (std::string arg; iss >> arg;) {
+				arguments.push_back(arg);
+			}
+			auto reply = [&](const std::string& message) { Send(id + " " + message); };
+
+			theBoard = session.board;
+			SetHashHistory(session.hashHistory);
+
+			auto& command = arguments[0];
+			auto closed = false;
+			if (command == "isready") {
+				reply("readyok");
+			}
+			else if (command == "position") {
+				if (!SetPosition(arguments, session.game)) {
+					reply("Invalid move");
+				}
+			}
+			else if (command == "move?") {
+				reply(SetGame({ "startpos" }, arguments, 1, session.game) ? "valid" : "invalid");
+			}
+			else if (command == "legalmoves") {
+				reply(FormatLegalMoves(arguments));
+			}
+			else if (command == "go") {
+				// Nothing could stop the search, so it needs a limit
+				auto limits = ParseSearchLimits(arguments);
+				limits.infinite = false;
+				limits.ponder = false;
+				if (!limits.HasLimits()) {
+					limits.moveTime = DEFAULT_MOVE_TIME;
+				}
+				auto move = FindBestMoveInTime(limits);
+				if (move == INVALID_MOVE) {
+					reply("bestmove 0000");
+				}
+				else {
+					reply(FormatBestMove(move));
+					DoMove(move);
+					theBoard.SwitchTurn();
+					session.game.moves.push_back(move);
+				}
+			}
+			else if (command == "getboard") {
+				reply("board " + GetProtocolString(theBoard));
+			}
+			else if (command == "close") {
+				SetDefaultBoard(theBoard);
+				ClearHistory();
+				session.game = {};
+				closed = true;
+			}
+			else {
+				reply("unknown command " + command);
+			}
+
+			session.board = theBoard;
+			session.hashHistory = GetHashHistory();
+			return closed;
+		}
+
+		std::mutex mutex;
+		std::condition_variable condition;
+		std::unordered_map<std::string, Session> sessions;
+		// Sessions with commands, each appears once
+		std::deque<std::string> ready;
+		bool quit = false;
+	};
+}
+
+void ServerLoop(int threads, int hashMegabytes) {
+	// Every worker searches with a share of the hash of its own, the shared table is not used
+	ResizeTranspositionTable(0);
+	auto megabytes = std::max(1, hashMegabytes / std::max(threads, 1));
+
+	SessionServer server;
+	std::vector<std::thread> workers;
+	for (int i = 0; i < threads; i++) {
+		workers.emplace_back([&server, megabytes]() {
+			UseThreadTranspositionTable(megabytes);
+			server.Work();
+		});
+	}
+
+	std::string line;
+	while (std::getline(std::cin, line)) {
+		std::istringstream iss(line);
+		std::string id;
+		std::string command;
+		iss >> id;
+		std::getline(iss >> std::ws, command);
+		if (id == "quit" || id == "exit") break;
+		if (id.empty() || command.empty()) continue;
+		server.Push(id, command);
+	}
+
+	server.Quit();
+	for (auto& worker : workers) {
+		worker.join();
+	}
+}
@@ -1,3 +1,7 @@
-#pragma once
-
-void UCILoop();
+#pragma once
+
+void UCILoop();
+// Plays many games at once, every input line is a session ID followed by a command for that session.
+// Sessions have their own position and share the book and the search workers, every worker has a table of its
+// own with an equal share of the hash.
+void ServerLoop(int threads, int hashMegabytes);
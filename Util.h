@@ -1,6 +1,6 @@
-#pragma once
-
-#include <sstream>
-#include <vector>
-
+#pragma once
+
+#include <sstream>
+#include <vector>
+
 std::vector<std::string> Split(const std::string& str, char delimiter);
\ No newline at end of file
@@ -1,11 +1,82 @@
-#pragma once
-
-
-#include "Square.h"
-#include "Piece.h"
-
-extern uint64_t turnHash;
-extern uint64_t castlingRightsHashes[2][2];
-extern uint64_t enPassantHashes[8];
-
-uint64_t GetZobristHash(Square square, Piece piece);
+#pragma once
+
+#include <cstdint>
+
+#include "Square.h"
+#include "Piece.h"
+
+// Stored in files that contain hashes, increase whenever the keys change so those files are rebuilt
+constexpr uint32_t ZOBRIST_VERSION = 1;
+
+// The sequence of a default constructed std::mt19937_64, which generated the keys before they were computed at compile time
+class ZobristRandom {
+public:
+	constexpr ZobristRandom() {
+		state[0] = 5489;
+		for (int i = 1; i < N; i++) {
+			state[i] = 6364136223846793005ULL * (state[i - 1] ^ (state[i - 1] >> 62)) + i;
+		}
+	}
+
+	constexpr auto Next() -> uint64_t {
+		if (index == N) Twist();
+		auto y = state[index++];
+		y ^= (y >> 29) & 0x5555555555555555ULL;
+		y ^= (y << 17) & 0x71D67FFFEDA60000ULL;
+		y ^= (y << 37) & 0xFFF7EEE000000000ULL;
+		return y ^ (y >> 43);
+	}
+
+private:
+	static constexpr int N = 312;
+	static constexpr int M = 156;
+
+	constexpr void Twist() {
+		for (int i = 0; i < N; i++) {
+			auto x = (state[i] & 0xFFFFFFFF80000000ULL) | (state[(i + 1) % N] & 0x7FFFFFFFULL);
+			auto xA = x >> 1;
+			if (x & 1) xA ^= 0xB5026F5AA96619E9ULL;
+			state[i] = state[(i + M) % N] ^ xA;
+		}
+		index = 0;
+	}
+
+	uint64_t state[N] = {};
+	int index = N;
+};
+
+struct ZobristKeys {
+	uint64_t turn = 0;
+	uint64_t castlingRights[2][2] = {};
+	uint64_t enPassant[8] = {};
+	uint64_t piecePosition[NUM_PIECE_VALUES * 64] = {};
+};
+
+// Drawn in the order of the original start-up code, so the keys and the files that contain hashes stay valid
+constexpr auto GenerateZobristKeys() -> ZobristKeys {
+	ZobristKeys keys;
+	ZobristRandom random;
+	keys.turn = random.Next();
+	for (auto color = 0; color < 2; color++) {
+		for (auto side = 0; side < 2; side++) {
+			keys.castlingRights[color][side] = random.Next();
+		}
+	}
+	for (int i = 0; i < 8; i++)
+		keys.enPassant[i] = random.Next();
+	// The pieces were numbered without gap between the colors, the black pieces moved up by two
+	for (auto i = 0; i < 64 * 13; i++) {
+		auto piece = i / 64 <= 6 ? i / 64 : i / 64 + 2;
+		keys.piecePosition[piece * 64 + i % 64] = random.Next();
+	}
+	return keys;
+}
+
+inline constexpr ZobristKeys zobristKeys = GenerateZobristKeys();
+inline constexpr uint64_t turnHash = zobristKeys.turn;
+inline constexpr auto& castlingRightsHashes = zobristKeys.castlingRights;
+inline constexpr auto& enPassantHashes = zobristKeys.enPassant;
+
+constexpr uint64_t GetZobristHash(Square square, Piece piece) {
+	return zobristKeys.piecePosition[static_cast<int>(piece) * 64 + square.rank * 8 + square.file];
+}